@@ -1,14 +1,50 @@
+#define _GNU_SOURCE
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#ifdef WIN64
+    #include <windows.h>
+#else
+    #include <sys/time.h>
+    #include <sys/select.h>
+    #include <time.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <pthread.h>
+    #include <sched.h>
+    #include <stdint.h>
+#endif
+#ifdef __linux__
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+#ifdef CHENGINE_LIBRARY
+    #include "chengine.h"
+#endif
 
 // Define bitboard data type
 #define U64 unsigned long long
 
+// Per thread engine state (library contexts search concurrently, each on its own thread)
+#ifdef _MSC_VER
+    #define engine_local __declspec(thread)
+#else
+    #define engine_local _Thread_local
+#endif
+
 // FEN dedug positions
 #define empty_board "8/8/8/8/8/8/8/8 w - - "
 #define start_position "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 "
 #define tricky_position "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1 "
-#define killer_position "rnbqkb1r/pp1p1pPp/8/2p1pP2/1P1P4/3P3P/P1P1P3/RNBQKBNR w KQkq e6 0 1"
+// Killer position lacks the illegal ninth white pawn (d3) of the tutorial FEN, its published node counts don't apply
+#define killer_position "rnbqkb1r/pp1p1pPp/8/2p1pP2/1P1P4/7P/P1P1P3/RNBQKBNR w KQkq e6 0 1"
 #define cmk_position "r2q1rk1/ppp2ppp/2n1bn2/2b1p3/3pP3/3P1NPP/PPP1NPB1/R1BQ1RK1 b - - 0 9 "
 
 // Board squares
@@ -75,26 +111,44 @@ int char_pieces[] = {
 /* ============================================================================= */
 
 // Piece bitboards
-U64 bitboards[12];
+engine_local U64 bitboards[12];
 
 // Occupancy bitboards
-U64 occupancies[3];
+engine_local U64 occupancies[3];
 
 // Side to move
-int side;
+engine_local int side;
 
 // Enpassant square
-int enpassant = no_sq;
+engine_local int enpassant = no_sq;
 
 // Castling rights
-int castle;
+engine_local int castle;
+
+// Halfmove clock (plies since last capture or pawn move)
+engine_local int fifty;
+
+// Fullmove number
+engine_local int fullmove = 1;
+
+// "Almost" unique position identifier aka hash key or position key
+engine_local U64 hash_key;
+
+// Position history size (game & search path since the last irreversible move)
+#define max_history 1024
+
+// Position keys preceding the current position
+engine_local U64 repetition_table[max_history];
+
+// Number of keys in position history
+engine_local int repetition_index;
 
 /* ================================================================================ */
 /* ============================== Random numbers ================================== */
 /* ================================================================================ */
 
 // Pseudo random number state
-unsigned int state = 1804289383;
+engine_local unsigned int state = 1804289383;
 
 // Generate 32-bit pseudo legal numbers
 unsigned int get_random_U32_number() {
@@ -133,6 +187,36 @@ U64 generate_magic_number() {
     return get_random_U64_number() & get_random_U64_number() & get_random_U64_number();
 }
 
+/* ========================================================================= */
+/* ============================== Timing =================================== */
+/* ========================================================================= */
+
+// Get time in milliseconds
+int get_time_ms() {
+    #ifdef WIN64
+        return GetTickCount();
+    #else
+        struct timeval time_value;
+        gettimeofday(&time_value, NULL);
+        return time_value.tv_sec * 1000 + time_value.tv_usec / 1000;
+    #endif
+}
+
+// Get monotonic time in nanoseconds (for timing short operations)
+long long get_time_ns() {
+    #ifdef WIN64
+        LARGE_INTEGER counter, frequency;
+        QueryPerformanceCounter(&counter);
+        QueryPerformanceFrequency(&frequency);
+        return counter.QuadPart / frequency.QuadPart * 1000000000LL +
+               counter.QuadPart % frequency.QuadPart * 1000000000LL / frequency.QuadPart;
+    #else
+        struct timespec time_value;
+        clock_gettime(CLOCK_MONOTONIC, &time_value);
+        return time_value.tv_sec * 1000000000LL + time_value.tv_nsec;
+    #endif
+}
+
 /* ========================================================================= */
 /* ========================= Bit manipulations ============================= */
 /* ========================================================================= */
@@ -142,8 +226,19 @@ U64 generate_magic_number() {
 #define get_bit(bitboard, square) ((bitboard) & (1ULL << (square)))
 #define pop_bit(bitboard, square) ((bitboard) &= ~(1ULL << (square)))
 
-// Count bits within a bitboard
-static inline int count_bits(U64 bitboard) {
+/*
+    Bit scan backends: compiler builtins by default (single POPCNT & TZCNT
+    instructions with -mpopcnt -mbmi or -march=native, table based code
+    otherwise), portable loops with -DPORTABLE_BITS or non GNU compilers.
+*/
+#if defined(__GNUC__) && !defined(PORTABLE_BITS)
+    #define bits_backend "builtin"
+#else
+    #define bits_backend "portable"
+#endif
+
+// Count bits within a bitboard (portable)
+static inline int count_bits_portable(U64 bitboard) {
     // Bit counter
     int count = 0;
 
@@ -160,12 +255,12 @@ static inline int count_bits(U64 bitboard) {
     return count;
 }
 
-// Get least significant 1st bit index
-static inline int get_ls1b_index(U64 bitboard) {
+// Get least significant 1st bit index (portable)
+static inline int get_ls1b_index_portable(U64 bitboard) {
     // Make sure bitboard is not 0
     if (bitboard) {
         // Count trailing bits before LS1B
-        return count_bits((bitboard & -bitboard) - 1);
+        return count_bits_portable((bitboard & -bitboard) - 1);
     }
     else {
         // Return illegal index
@@ -173,6 +268,308 @@ static inline int get_ls1b_index(U64 bitboard) {
     }
 }
 
+// Count bits within a bitboard
+static inline int count_bits(U64 bitboard) {
+    #if defined(__GNUC__) && !defined(PORTABLE_BITS)
+        return __builtin_popcountll(bitboard);
+    #else
+        return count_bits_portable(bitboard);
+    #endif
+}
+
+// Get least significant 1st bit index (-1 for empty bitboard)
+static inline int get_ls1b_index(U64 bitboard) {
+    #if defined(__GNUC__) && !defined(PORTABLE_BITS)
+        return bitboard ? __builtin_ctzll(bitboard) : -1;
+    #else
+        return get_ls1b_index_portable(bitboard);
+    #endif
+}
+
+/* ========================================================================= */
+/* ============================= Zobrist keys ============================== */
+/* ========================================================================= */
+
+// Polyglot key layout: 12 x 64 pieces, 4 castling rights, 8 enpassant files, side to move
+// (the standard Random64 table from the Polyglot book format specification)
+const U64 polyglot_random[781] = {
+    0x9D39247E33776D41ULL, 0x2AF7398005AAA5C7ULL, 0x44DB015024623547ULL, 0x9C15F73E62A76AE2ULL,
+    0x75834465489C0C89ULL, 0x3290AC3A203001BFULL, 0x0FBBAD1F61042279ULL, 0xE83A908FF2FB60CAULL,
+    0x0D7E765D58755C10ULL, 0x1A083822CEAFE02DULL, 0x9605D5F0E25EC3B0ULL, 0xD021FF5CD13A2ED5ULL,
+    0x40BDF15D4A672E32ULL, 0x011355146FD56395ULL, 0x5DB4832046F3D9E5ULL, 0x239F8B2D7FF719CCULL,
+    0x05D1A1AE85B49AA1ULL, 0x679F848F6E8FC971ULL, 0x7449BBFF801FED0BULL, 0x7D11CDB1C3B7ADF0ULL,
+    0x82C7709E781EB7CCULL, 0xF3218F1C9510786CULL, 0x331478F3AF51BBE6ULL, 0x4BB38DE5E7219443ULL,
+    0xAA649C6EBCFD50FCULL, 0x8DBD98A352AFD40BULL, 0x87D2074B81D79217ULL, 0x19F3C751D3E92AE1ULL,
+    0xB4AB30F062B19ABFULL, 0x7B0500AC42047AC4ULL, 0xC9452CA81A09D85DULL, 0x24AA6C514DA27500ULL,
+    0x4C9F34427501B447ULL, 0x14A68FD73C910841ULL, 0xA71B9B83461CBD93ULL, 0x03488B95B0F1850FULL,
+    0x637B2B34FF93C040ULL, 0x09D1BC9A3DD90A94ULL, 0x3575668334A1DD3BULL, 0x735E2B97A4C45A23ULL,
+    0x18727070F1BD400BULL, 0x1FCBACD259BF02E7ULL, 0xD310A7C2CE9B6555ULL, 0xBF983FE0FE5D8244ULL,
+    0x9F74D14F7454A824ULL, 0x51EBDC4AB9BA3035ULL, 0x5C82C505DB9AB0FAULL, 0xFCF7FE8A3430B241ULL,
+    0x3253A729B9BA3DDEULL, 0x8C74C368081B3075ULL, 0xB9BC6C87167C33E7ULL, 0x7EF48F2B83024E20ULL,
+    0x11D505D4C351BD7FULL, 0x6568FCA92C76A243ULL, 0x4DE0B0F40F32A7B8ULL, 0x96D693460CC37E5DULL,
+    0x42E240CB63689F2FULL, 0x6D2BDCDAE2919661ULL, 0x42880B0236E4D951ULL, 0x5F0F4A5898171BB6ULL,
+    0x39F890F579F92F88ULL, 0x93C5B5F47356388BULL, 0x63DC359D8D231B78ULL, 0xEC16CA8AEA98AD76ULL,
+    0x5355F900C2A82DC7ULL, 0x07FB9F855A997142ULL, 0x5093417AA8A7ED5EULL, 0x7BCBC38DA25A7F3CULL,
+    0x19FC8A768CF4B6D4ULL, 0x637A7780DECFC0D9ULL, 0x8249A47AEE0E41F7ULL, 0x79AD695501E7D1E8ULL,
+    0x14ACBAF4777D5776ULL, 0xF145B6BECCDEA195ULL, 0xDABF2AC8201752FCULL, 0x24C3C94DF9C8D3F6ULL,
+    0xBB6E2924F03912EAULL, 0x0CE26C0B95C980D9ULL, 0xA49CD132BFBF7CC4ULL, 0xE99D662AF4243939ULL,
+    0x27E6AD7891165C3FULL, 0x8535F040B9744FF1ULL, 0x54B3F4FA5F40D873ULL, 0x72B12C32127FED2BULL,
+    0xEE954D3C7B411F47ULL, 0x9A85AC909A24EAA1ULL, 0x70AC4CD9F04F21F5ULL, 0xF9B89D3E99A075C2ULL,
+    0x87B3E2B2B5C907B1ULL, 0xA366E5B8C54F48B8ULL, 0xAE4A9346CC3F7CF2ULL, 0x1920C04D47267BBDULL,
+    0x87BF02C6B49E2AE9ULL, 0x092237AC237F3859ULL, 0xFF07F64EF8ED14D0ULL, 0x8DE8DCA9F03CC54EULL,
+    0x9C1633264DB49C89ULL, 0xB3F22C3D0B0B38EDULL, 0x390E5FB44D01144BULL, 0x5BFEA5B4712768E9ULL,
+    0x1E1032911FA78984ULL, 0x9A74ACB964E78CB3ULL, 0x4F80F7A035DAFB04ULL, 0x6304D09A0B3738C4ULL,
+    0x2171E64683023A08ULL, 0x5B9B63EB9CEFF80CULL, 0x506AACF489889342ULL, 0x1881AFC9A3A701D6ULL,
+    0x6503080440750644ULL, 0xDFD395339CDBF4A7ULL, 0xEF927DBCF00C20F2ULL, 0x7B32F7D1E03680ECULL,
+    0xB9FD7620E7316243ULL, 0x05A7E8A57DB91B77ULL, 0xB5889C6E15630A75ULL, 0x4A750A09CE9573F7ULL,
+    0xCF464CEC899A2F8AULL, 0xF538639CE705B824ULL, 0x3C79A0FF5580EF7FULL, 0xEDE6C87F8477609DULL,
+    0x799E81F05BC93F31ULL, 0x86536B8CF3428A8CULL, 0x97D7374C60087B73ULL, 0xA246637CFF328532ULL,
+    0x043FCAE60CC0EBA0ULL, 0x920E449535DD359EULL, 0x70EB093B15B290CCULL, 0x73A1921916591CBDULL,
+    0x56436C9FE1A1AA8DULL, 0xEFAC4B70633B8F81ULL, 0xBB215798D45DF7AFULL, 0x45F20042F24F1768ULL,
+    0x930F80F4E8EB7462ULL, 0xFF6712FFCFD75EA1ULL, 0xAE623FD67468AA70ULL, 0xDD2C5BC84BC8D8FCULL,
+    0x7EED120D54CF2DD9ULL, 0x22FE545401165F1CULL, 0xC91800E98FB99929ULL, 0x808BD68E6AC10365ULL,
+    0xDEC468145B7605F6ULL, 0x1BEDE3A3AEF53302ULL, 0x43539603D6C55602ULL, 0xAA969B5C691CCB7AULL,
+    0xA87832D392EFEE56ULL, 0x65942C7B3C7E11AEULL, 0xDED2D633CAD004F6ULL, 0x21F08570F420E565ULL,
+    0xB415938D7DA94E3CULL, 0x91B859E59ECB6350ULL, 0x10CFF333E0ED804AULL, 0x28AED140BE0BB7DDULL,
+    0xC5CC1D89724FA456ULL, 0x5648F680F11A2741ULL, 0x2D255069F0B7DAB3ULL, 0x9BC5A38EF729ABD4ULL,
+    0xEF2F054308F6A2BCULL, 0xAF2042F5CC5C2858ULL, 0x480412BAB7F5BE2AULL, 0xAEF3AF4A563DFE43ULL,
+    0x19AFE59AE451497FULL, 0x52593803DFF1E840ULL, 0xF4F076E65F2CE6F0ULL, 0x11379625747D5AF3ULL,
+    0xBCE5D2248682C115ULL, 0x9DA4243DE836994FULL, 0x066F70B33FE09017ULL, 0x4DC4DE189B671A1CULL,
+    0x51039AB7712457C3ULL, 0xC07A3F80C31FB4B4ULL, 0xB46EE9C5E64A6E7CULL, 0xB3819A42ABE61C87ULL,
+    0x21A007933A522A20ULL, 0x2DF16F761598AA4FULL, 0x763C4A1371B368FDULL, 0xF793C46702E086A0ULL,
+    0xD7288E012AEB8D31ULL, 0xDE336A2A4BC1C44BULL, 0x0BF692B38D079F23ULL, 0x2C604A7A177326B3ULL,
+    0x4850E73E03EB6064ULL, 0xCFC447F1E53C8E1BULL, 0xB05CA3F564268D99ULL, 0x9AE182C8BC9474E8ULL,
+    0xA4FC4BD4FC5558CAULL, 0xE755178D58FC4E76ULL, 0x69B97DB1A4C03DFEULL, 0xF9B5B7C4ACC67C96ULL,
+    0xFC6A82D64B8655FBULL, 0x9C684CB6C4D24417ULL, 0x8EC97D2917456ED0ULL, 0x6703DF9D2924E97EULL,
+    0xC547F57E42A7444EULL, 0x78E37644E7CAD29EULL, 0xFE9A44E9362F05FAULL, 0x08BD35CC38336615ULL,
+    0x9315E5EB3A129ACEULL, 0x94061B871E04DF75ULL, 0xDF1D9F9D784BA010ULL, 0x3BBA57B68871B59DULL,
+    0xD2B7ADEEDED1F73FULL, 0xF7A255D83BC373F8ULL, 0xD7F4F2448C0CEB81ULL, 0xD95BE88CD210FFA7ULL,
+    0x336F52F8FF4728E7ULL, 0xA74049DAC312AC71ULL, 0xA2F61BB6E437FDB5ULL, 0x4F2A5CB07F6A35B3ULL,
+    0x87D380BDA5BF7859ULL, 0x16B9F7E06C453A21ULL, 0x7BA2484C8A0FD54EULL, 0xF3A678CAD9A2E38CULL,
+    0x39B0BF7DDE437BA2ULL, 0xFCAF55C1BF8A4424ULL, 0x18FCF680573FA594ULL, 0x4C0563B89F495AC3ULL,
+    0x40E087931A00930DULL, 0x8CFFA9412EB642C1ULL, 0x68CA39053261169FULL, 0x7A1EE967D27579E2ULL,
+    0x9D1D60E5076F5B6FULL, 0x3810E399B6F65BA2ULL, 0x32095B6D4AB5F9B1ULL, 0x35CAB62109DD038AULL,
+    0xA90B24499FCFAFB1ULL, 0x77A225A07CC2C6BDULL, 0x513E5E634C70E331ULL, 0x4361C0CA3F692F12ULL,
+    0xD941ACA44B20A45BULL, 0x528F7C8602C5807BULL, 0x52AB92BEB9613989ULL, 0x9D1DFA2EFC557F73ULL,
+    0x722FF175F572C348ULL, 0x1D1260A51107FE97ULL, 0x7A249A57EC0C9BA2ULL, 0x04208FE9E8F7F2D6ULL,
+    0x5A110C6058B920A0ULL, 0x0CD9A497658A5698ULL, 0x56FD23C8F9715A4CULL, 0x284C847B9D887AAEULL,
+    0x04FEABFBBDB619CBULL, 0x742E1E651C60BA83ULL, 0x9A9632E65904AD3CULL, 0x881B82A13B51B9E2ULL,
+    0x506E6744CD974924ULL, 0xB0183DB56FFC6A79ULL, 0x0ED9B915C66ED37EULL, 0x5E11E86D5873D484ULL,
+    0xF678647E3519AC6EULL, 0x1B85D488D0F20CC5ULL, 0xDAB9FE6525D89021ULL, 0x0D151D86ADB73615ULL,
+    0xA865A54EDCC0F019ULL, 0x93C42566AEF98FFBULL, 0x99E7AFEABE000731ULL, 0x48CBFF086DDF285AULL,
+    0x7F9B6AF1EBF78BAFULL, 0x58627E1A149BBA21ULL, 0x2CD16E2ABD791E33ULL, 0xD363EFF5F0977996ULL,
+    0x0CE2A38C344A6EEDULL, 0x1A804AADB9CFA741ULL, 0x907F30421D78C5DEULL, 0x501F65EDB3034D07ULL,
+    0x37624AE5A48FA6E9ULL, 0x957BAF61700CFF4EULL, 0x3A6C27934E31188AULL, 0xD49503536ABCA345ULL,
+    0x088E049589C432E0ULL, 0xF943AEE7FEBF21B8ULL, 0x6C3B8E3E336139D3ULL, 0x364F6FFA464EE52EULL,
+    0xD60F6DCEDC314222ULL, 0x56963B0DCA418FC0ULL, 0x16F50EDF91E513AFULL, 0xEF1955914B609F93ULL,
+    0x565601C0364E3228ULL, 0xECB53939887E8175ULL, 0xBAC7A9A18531294BULL, 0xB344C470397BBA52ULL,
+    0x65D34954DAF3CEBDULL, 0xB4B81B3FA97511E2ULL, 0xB422061193D6F6A7ULL, 0x071582401C38434DULL,
+    0x7A13F18BBEDC4FF5ULL, 0xBC4097B116C524D2ULL, 0x59B97885E2F2EA28ULL, 0x99170A5DC3115544ULL,
+    0x6F423357E7C6A9F9ULL, 0x325928EE6E6F8794ULL, 0xD0E4366228B03343ULL, 0x565C31F7DE89EA27ULL,
+    0x30F5611484119414ULL, 0xD873DB391292ED4FULL, 0x7BD94E1D8E17DEBCULL, 0xC7D9F16864A76E94ULL,
+    0x947AE053EE56E63CULL, 0xC8C93882F9475F5FULL, 0x3A9BF55BA91F81CAULL, 0xD9A11FBB3D9808E4ULL,
+    0x0FD22063EDC29FCAULL, 0xB3F256D8ACA0B0B9ULL, 0xB03031A8B4516E84ULL, 0x35DD37D5871448AFULL,
+    0xE9F6082B05542E4EULL, 0xEBFAFA33D7254B59ULL, 0x9255ABB50D532280ULL, 0xB9AB4CE57F2D34F3ULL,
+    0x693501D628297551ULL, 0xC62C58F97DD949BFULL, 0xCD454F8F19C5126AULL, 0xBBE83F4ECC2BDECBULL,
+    0xDC842B7E2819E230ULL, 0xBA89142E007503B8ULL, 0xA3BC941D0A5061CBULL, 0xE9F6760E32CD8021ULL,
+    0x09C7E552BC76492FULL, 0x852F54934DA55CC9ULL, 0x8107FCCF064FCF56ULL, 0x098954D51FFF6580ULL,
+    0x23B70EDB1955C4BFULL, 0xC330DE426430F69DULL, 0x4715ED43E8A45C0AULL, 0xA8D7E4DAB780A08DULL,
+    0x0572B974F03CE0BBULL, 0xB57D2E985E1419C7ULL, 0xE8D9ECBE2CF3D73FULL, 0x2FE4B17170E59750ULL,
+    0x11317BA87905E790ULL, 0x7FBF21EC8A1F45ECULL, 0x1725CABFCB045B00ULL, 0x964E915CD5E2B207ULL,
+    0x3E2B8BCBF016D66DULL, 0xBE7444E39328A0ACULL, 0xF85B2B4FBCDE44B7ULL, 0x49353FEA39BA63B1ULL,
+    0x1DD01AAFCD53486AULL, 0x1FCA8A92FD719F85ULL, 0xFC7C95D827357AFAULL, 0x18A6A990C8B35EBDULL,
+    0xCCCB7005C6B9C28DULL, 0x3BDBB92C43B17F26ULL, 0xAA70B5B4F89695A2ULL, 0xE94C39A54A98307FULL,
+    0xB7A0B174CFF6F36EULL, 0xD4DBA84729AF48ADULL, 0x2E18BC1AD9704A68ULL, 0x2DE0966DAF2F8B1CULL,
+    0xB9C11D5B1E43A07EULL, 0x64972D68DEE33360ULL, 0x94628D38D0C20584ULL, 0xDBC0D2B6AB90A559ULL,
+    0xD2733C4335C6A72FULL, 0x7E75D99D94A70F4DULL, 0x6CED1983376FA72BULL, 0x97FCAACBF030BC24ULL,
+    0x7B77497B32503B12ULL, 0x8547EDDFB81CCB94ULL, 0x79999CDFF70902CBULL, 0xCFFE1939438E9B24ULL,
+    0x829626E3892D95D7ULL, 0x92FAE24291F2B3F1ULL, 0x63E22C147B9C3403ULL, 0xC678B6D860284A1CULL,
+    0x5873888850659AE7ULL, 0x0981DCD296A8736DULL, 0x9F65789A6509A440ULL, 0x9FF38FED72E9052FULL,
+    0xE479EE5B9930578CULL, 0xE7F28ECD2D49EECDULL, 0x56C074A581EA17FEULL, 0x5544F7D774B14AEFULL,
+    0x7B3F0195FC6F290FULL, 0x12153635B2C0CF57ULL, 0x7F5126DBBA5E0CA7ULL, 0x7A76956C3EAFB413ULL,
+    0x3D5774A11D31AB39ULL, 0x8A1B083821F40CB4ULL, 0x7B4A38E32537DF62ULL, 0x950113646D1D6E03ULL,
+    0x4DA8979A0041E8A9ULL, 0x3BC36E078F7515D7ULL, 0x5D0A12F27AD310D1ULL, 0x7F9D1A2E1EBE1327ULL,
+    0xDA3A361B1C5157B1ULL, 0xDCDD7D20903D0C25ULL, 0x36833336D068F707ULL, 0xCE68341F79893389ULL,
+    0xAB9090168DD05F34ULL, 0x43954B3252DC25E5ULL, 0xB438C2B67F98E5E9ULL, 0x10DCD78E3851A492ULL,
+    0xDBC27AB5447822BFULL, 0x9B3CDB65F82CA382ULL, 0xB67B7896167B4C84ULL, 0xBFCED1B0048EAC50ULL,
+    0xA9119B60369FFEBDULL, 0x1FFF7AC80904BF45ULL, 0xAC12FB171817EEE7ULL, 0xAF08DA9177DDA93DULL,
+    0x1B0CAB936E65C744ULL, 0xB559EB1D04E5E932ULL, 0xC37B45B3F8D6F2BAULL, 0xC3A9DC228CAAC9E9ULL,
+    0xF3B8B6675A6507FFULL, 0x9FC477DE4ED681DAULL, 0x67378D8ECCEF96CBULL, 0x6DD856D94D259236ULL,
+    0xA319CE15B0B4DB31ULL, 0x073973751F12DD5EULL, 0x8A8E849EB32781A5ULL, 0xE1925C71285279F5ULL,
+    0x74C04BF1790C0EFEULL, 0x4DDA48153C94938AULL, 0x9D266D6A1CC0542CULL, 0x7440FB816508C4FEULL,
+    0x13328503DF48229FULL, 0xD6BF7BAEE43CAC40ULL, 0x4838D65F6EF6748FULL, 0x1E152328F3318DEAULL,
+    0x8F8419A348F296BFULL, 0x72C8834A5957B511ULL, 0xD7A023A73260B45CULL, 0x94EBC8ABCFB56DAEULL,
+    0x9FC10D0F989993E0ULL, 0xDE68A2355B93CAE6ULL, 0xA44CFE79AE538BBEULL, 0x9D1D84FCCE371425ULL,
+    0x51D2B1AB2DDFB636ULL, 0x2FD7E4B9E72CD38CULL, 0x65CA5B96B7552210ULL, 0xDD69A0D8AB3B546DULL,
+    0x604D51B25FBF70E2ULL, 0x73AA8A564FB7AC9EULL, 0x1A8C1E992B941148ULL, 0xAAC40A2703D9BEA0ULL,
+    0x764DBEAE7FA4F3A6ULL, 0x1E99B96E70A9BE8BULL, 0x2C5E9DEB57EF4743ULL, 0x3A938FEE32D29981ULL,
+    0x26E6DB8FFDF5ADFEULL, 0x469356C504EC9F9DULL, 0xC8763C5B08D1908CULL, 0x3F6C6AF859D80055ULL,
+    0x7F7CC39420A3A545ULL, 0x9BFB227EBDF4C5CEULL, 0x89039D79D6FC5C5CULL, 0x8FE88B57305E2AB6ULL,
+    0xA09E8C8C35AB96DEULL, 0xFA7E393983325753ULL, 0xD6B6D0ECC617C699ULL, 0xDFEA21EA9E7557E3ULL,
+    0xB67C1FA481680AF8ULL, 0xCA1E3785A9E724E5ULL, 0x1CFC8BED0D681639ULL, 0xD18D8549D140CAEAULL,
+    0x4ED0FE7E9DC91335ULL, 0xE4DBF0634473F5D2ULL, 0x1761F93A44D5AEFEULL, 0x53898E4C3910DA55ULL,
+    0x734DE8181F6EC39AULL, 0x2680B122BAA28D97ULL, 0x298AF231C85BAFABULL, 0x7983EED3740847D5ULL,
+    0x66C1A2A1A60CD889ULL, 0x9E17E49642A3E4C1ULL, 0xEDB454E7BADC0805ULL, 0x50B704CAB602C329ULL,
+    0x4CC317FB9CDDD023ULL, 0x66B4835D9EAFEA22ULL, 0x219B97E26FFC81BDULL, 0x261E4E4C0A333A9DULL,
+    0x1FE2CCA76517DB90ULL, 0xD7504DFA8816EDBBULL, 0xB9571FA04DC089C8ULL, 0x1DDC0325259B27DEULL,
+    0xCF3F4688801EB9AAULL, 0xF4F5D05C10CAB243ULL, 0x38B6525C21A42B0EULL, 0x36F60E2BA4FA6800ULL,
+    0xEB3593803173E0CEULL, 0x9C4CD6257C5A3603ULL, 0xAF0C317D32ADAA8AULL, 0x258E5A80C7204C4BULL,
+    0x8B889D624D44885DULL, 0xF4D14597E660F855ULL, 0xD4347F66EC8941C3ULL, 0xE699ED85B0DFB40DULL,
+    0x2472F6207C2D0484ULL, 0xC2A1E7B5B459AEB5ULL, 0xAB4F6451CC1D45ECULL, 0x63767572AE3D6174ULL,
+    0xA59E0BD101731A28ULL, 0x116D0016CB948F09ULL, 0x2CF9C8CA052F6E9FULL, 0x0B090A7560A968E3ULL,
+    0xABEEDDB2DDE06FF1ULL, 0x58EFC10B06A2068DULL, 0xC6E57A78FBD986E0ULL, 0x2EAB8CA63CE802D7ULL,
+    0x14A195640116F336ULL, 0x7C0828DD624EC390ULL, 0xD74BBE77E6116AC7ULL, 0x804456AF10F5FB53ULL,
+    0xEBE9EA2ADF4321C7ULL, 0x03219A39EE587A30ULL, 0x49787FEF17AF9924ULL, 0xA1E9300CD8520548ULL,
+    0x5B45E522E4B1B4EFULL, 0xB49C3B3995091A36ULL, 0xD4490AD526F14431ULL, 0x12A8F216AF9418C2ULL,
+    0x001F837CC7350524ULL, 0x1877B51E57A764D5ULL, 0xA2853B80F17F58EEULL, 0x993E1DE72D36D310ULL,
+    0xB3598080CE64A656ULL, 0x252F59CF0D9F04BBULL, 0xD23C8E176D113600ULL, 0x1BDA0492E7E4586EULL,
+    0x21E0BD5026C619BFULL, 0x3B097ADAF088F94EULL, 0x8D14DEDB30BE846EULL, 0xF95CFFA23AF5F6F4ULL,
+    0x3871700761B3F743ULL, 0xCA672B91E9E4FA16ULL, 0x64C8E531BFF53B55ULL, 0x241260ED4AD1E87DULL,
+    0x106C09B972D2E822ULL, 0x7FBA195410E5CA30ULL, 0x7884D9BC6CB569D8ULL, 0x0647DFEDCD894A29ULL,
+    0x63573FF03E224774ULL, 0x4FC8E9560F91B123ULL, 0x1DB956E450275779ULL, 0xB8D91274B9E9D4FBULL,
+    0xA2EBEE47E2FBFCE1ULL, 0xD9F1F30CCD97FB09ULL, 0xEFED53D75FD64E6BULL, 0x2E6D02C36017F67FULL,
+    0xA9AA4D20DB084E9BULL, 0xB64BE8D8B25396C1ULL, 0x70CB6AF7C2D5BCF0ULL, 0x98F076A4F7A2322EULL,
+    0xBF84470805E69B5FULL, 0x94C3251F06F90CF3ULL, 0x3E003E616A6591E9ULL, 0xB925A6CD0421AFF3ULL,
+    0x61BDD1307C66E300ULL, 0xBF8D5108E27E0D48ULL, 0x240AB57A8B888B20ULL, 0xFC87614BAF287E07ULL,
+    0xEF02CDD06FFDB432ULL, 0xA1082C0466DF6C0AULL, 0x8215E577001332C8ULL, 0xD39BB9C3A48DB6CFULL,
+    0x2738259634305C14ULL, 0x61CF4F94C97DF93DULL, 0x1B6BACA2AE4E125BULL, 0x758F450C88572E0BULL,
+    0x959F587D507A8359ULL, 0xB063E962E045F54DULL, 0x60E8ED72C0DFF5D1ULL, 0x7B64978555326F9FULL,
+    0xFD080D236DA814BAULL, 0x8C90FD9B083F4558ULL, 0x106F72FE81E2C590ULL, 0x7976033A39F7D952ULL,
+    0xA4EC0132764CA04BULL, 0x733EA705FAE4FA77ULL, 0xB4D8F77BC3E56167ULL, 0x9E21F4F903B33FD9ULL,
+    0x9D765E419FB69F6DULL, 0xD30C088BA61EA5EFULL, 0x5D94337FBFAF7F5BULL, 0x1A4E4822EB4D7A59ULL,
+    0x6FFE73E81B637FB3ULL, 0xDDF957BC36D8B9CAULL, 0x64D0E29EEA8838B3ULL, 0x08DD9BDFD96B9F63ULL,
+    0x087E79E5A57D1D13ULL, 0xE328E230E3E2B3FBULL, 0x1C2559E30F0946BEULL, 0x720BF5F26F4D2EAAULL,
+    0xB0774D261CC609DBULL, 0x443F64EC5A371195ULL, 0x4112CF68649A260EULL, 0xD813F2FAB7F5C5CAULL,
+    0x660D3257380841EEULL, 0x59AC2C7873F910A3ULL, 0xE846963877671A17ULL, 0x93B633ABFA3469F8ULL,
+    0xC0C0F5A60EF4CDCFULL, 0xCAF21ECD4377B28CULL, 0x57277707199B8175ULL, 0x506C11B9D90E8B1DULL,
+    0xD83CC2687A19255FULL, 0x4A29C6465A314CD1ULL, 0xED2DF21216235097ULL, 0xB5635C95FF7296E2ULL,
+    0x22AF003AB672E811ULL, 0x52E762596BF68235ULL, 0x9AEBA33AC6ECC6B0ULL, 0x944F6DE09134DFB6ULL,
+    0x6C47BEC883A7DE39ULL, 0x6AD047C430A12104ULL, 0xA5B1CFDBA0AB4067ULL, 0x7C45D833AFF07862ULL,
+    0x5092EF950A16DA0BULL, 0x9338E69C052B8E7BULL, 0x455A4B4CFE30E3F5ULL, 0x6B02E63195AD0CF8ULL,
+    0x6B17B224BAD6BF27ULL, 0xD1E0CCD25BB9C169ULL, 0xDE0C89A556B9AE70ULL, 0x50065E535A213CF6ULL,
+    0x9C1169FA2777B874ULL, 0x78EDEFD694AF1EEDULL, 0x6DC93D9526A50E68ULL, 0xEE97F453F06791EDULL,
+    0x32AB0EDB696703D3ULL, 0x3A6853C7E70757A7ULL, 0x31865CED6120F37DULL, 0x67FEF95D92607890ULL,
+    0x1F2B1D1F15F6DC9CULL, 0xB69E38A8965C6B65ULL, 0xAA9119FF184CCCF4ULL, 0xF43C732873F24C13ULL,
+    0xFB4A3D794A9A80D2ULL, 0x3550C2321FD6109CULL, 0x371F77E76BB8417EULL, 0x6BFA9AAE5EC05779ULL,
+    0xCD04F3FF001A4778ULL, 0xE3273522064480CAULL, 0x9F91508BFFCFC14AULL, 0x049A7F41061A9E60ULL,
+    0xFCB6BE43A9F2FE9BULL, 0x08DE8A1C7797DA9BULL, 0x8F9887E6078735A1ULL, 0xB5B4071DBFC73A66ULL,
+    0x230E343DFBA08D33ULL, 0x43ED7F5A0FAE657DULL, 0x3A88A0FBBCB05C63ULL, 0x21874B8B4D2DBC4FULL,
+    0x1BDEA12E35F6A8C9ULL, 0x53C065C6C8E63528ULL, 0xE34A1D250E7A8D6BULL, 0xD6B04D3B7651DD7EULL,
+    0x5E90277E7CB39E2DULL, 0x2C046F22062DC67DULL, 0xB10BB459132D0A26ULL, 0x3FA9DDFB67E2F199ULL,
+    0x0E09B88E1914F7AFULL, 0x10E8B35AF3EEAB37ULL, 0x9EEDECA8E272B933ULL, 0xD4C718BC4AE8AE5FULL,
+    0x81536D601170FC20ULL, 0x91B534F885818A06ULL, 0xEC8177F83F900978ULL, 0x190E714FADA5156EULL,
+    0xB592BF39B0364963ULL, 0x89C350C893AE7DC1ULL, 0xAC042E70F8B383F2ULL, 0xB49B52E587A1EE60ULL,
+    0xFB152FE3FF26DA89ULL, 0x3E666E6F69AE2C15ULL, 0x3B544EBE544C19F9ULL, 0xE805A1E290CF2456ULL,
+    0x24B33C9D7ED25117ULL, 0xE74733427B72F0C1ULL, 0x0A804D18B7097475ULL, 0x57E3306D881EDB4FULL,
+    0x4AE7D6A36EB5DBCBULL, 0x2D8D5432157064C8ULL, 0xD1E649DE1E7F268BULL, 0x8A328A1CEDFE552CULL,
+    0x07A3AEC79624C7DAULL, 0x84547DDC3E203C94ULL, 0x990A98FD5071D263ULL, 0x1A4FF12616EEFC89ULL,
+    0xF6F7FD1431714200ULL, 0x30C05B1BA332F41CULL, 0x8D2636B81555A786ULL, 0x46C9FEB55D120902ULL,
+    0xCCEC0A73B49C9921ULL, 0x4E9D2827355FC492ULL, 0x19EBB029435DCB0FULL, 0x4659D2B743848A2CULL,
+    0x963EF2C96B33BE31ULL, 0x74F85198B05A2E7DULL, 0x5A0F544DD2B1FB18ULL, 0x03727073C2E134B1ULL,
+    0xC7F6AA2DE59AEA61ULL, 0x352787BAA0D7C22FULL, 0x9853EAB63B5E0B35ULL, 0xABBDCDD7ED5C0860ULL,
+    0xCF05DAF5AC8D77B0ULL, 0x49CAD48CEBF4A71EULL, 0x7A4C10EC2158C4A6ULL, 0xD9E92AA246BF719EULL,
+    0x13AE978D09FE5557ULL, 0x730499AF921549FFULL, 0x4E4B705B92903BA4ULL, 0xFF577222C14F0A3AULL,
+    0x55B6344CF97AAFAEULL, 0xB862225B055B6960ULL, 0xCAC09AFBDDD2CDB4ULL, 0xDAF8E9829FE96B5FULL,
+    0xB5FDFC5D3132C498ULL, 0x310CB380DB6F7503ULL, 0xE87FBB46217A360EULL, 0x2102AE466EBB1148ULL,
+    0xF8549E1A3AA5E00DULL, 0x07A69AFDCC42261AULL, 0xC4C118BFE78FEAAEULL, 0xF9F4892ED96BD438ULL,
+    0x1AF3DBE25D8F45DAULL, 0xF5B4B0B0D2DEEEB4ULL, 0x962ACEEFA82E1C84ULL, 0x046E3ECAAF453CE9ULL,
+    0xF05D129681949A4CULL, 0x964781CE734B3C84ULL, 0x9C2ED44081CE5FBDULL, 0x522E23F3925E319EULL,
+    0x177E00F9FC32F791ULL, 0x2BC60A63A6F3B3F2ULL, 0x222BBFAE61725606ULL, 0x486289DDCC3D6780ULL,
+    0x7DC7785B8EFDFC80ULL, 0x8AF38731C02BA980ULL, 0x1FAB64EA29A2DDF7ULL, 0xE4D9429322CD065AULL,
+    0x9DA058C67844F20CULL, 0x24C0E332B70019B0ULL, 0x233003B5A6CFE6ADULL, 0xD586BD01C5C217F6ULL,
+    0x5E5637885F29BC2BULL, 0x7EBA726D8C94094BULL, 0x0A56A5F0BFE39272ULL, 0xD79476A84EE20D06ULL,
+    0x9E4C1269BAA4BF37ULL, 0x17EFEE45B0DEE640ULL, 0x1D95B0A5FCF90BC6ULL, 0x93CBE0B699C2585DULL,
+    0x65FA4F227A2B6D79ULL, 0xD5F9E858292504D5ULL, 0xC2B5A03F71471A6FULL, 0x59300222B4561E00ULL,
+    0xCE2F8642CA0712DCULL, 0x7CA9723FBB2E8988ULL, 0x2785338347F2BA08ULL, 0xC61BB3A141E50E8CULL,
+    0x150F361DAB9DEC26ULL, 0x9F6A419D382595F4ULL, 0x64A53DC924FE7AC9ULL, 0x142DE49FFF7A7C3DULL,
+    0x0C335248857FA9E7ULL, 0x0A9C32D5EAE45305ULL, 0xE6C42178C4BBB92EULL, 0x71F1CE2490D20B07ULL,
+    0xF1BCC3D275AFE51AULL, 0xE728E8C83C334074ULL, 0x96FBF83A12884624ULL, 0x81A1549FD6573DA5ULL,
+    0x5FA7867CAF35E149ULL, 0x56986E2EF3ED091BULL, 0x917F1DD5F8886C61ULL, 0xD20D8C88C8FFE65FULL,
+    0x31D71DCE64B2C310ULL, 0xF165B587DF898190ULL, 0xA57E6339DD2CF3A0ULL, 0x1EF6E6DBB1961EC9ULL,
+    0x70CC73D90BC26E24ULL, 0xE21A6B35DF0C3AD7ULL, 0x003A93D8B2806962ULL, 0x1C99DED33CB890A1ULL,
+    0xCF3145DE0ADD4289ULL, 0xD0E4427A5514FB72ULL, 0x77C621CC9FB3A483ULL, 0x67A34DAC4356550BULL,
+    0xF8D626AAAF278509ULL
+};
+
+// Polyglot key offsets
+enum { polyglot_castle = 768, polyglot_enpassant = 772, polyglot_turn = 780 };
+
+// Random piece keys [piece][square]
+U64 piece_keys[12][64];
+
+// Random enpassant keys [square]
+U64 enpassant_keys[64];
+
+// Random castling keys [castling rights]
+U64 castle_keys[16];
+
+// Random side key (hashed when white is to move, like Polyglot does)
+U64 side_key;
+
+// Init hashing keys
+void init_random_keys() {
+    // Loop over pieces & board squares
+    for (int piece = P; piece <= k; piece++) {
+        // Polyglot piece kind (black pawn 0, white pawn 1, black knight 2 ... white king 11)
+        int kind = (piece % 6) * 2 + (piece < p);
+
+        // Polyglot squares count from a1 while engine squares count from a8
+        for (int square = 0; square < 64; square++)
+            piece_keys[piece][square] = polyglot_random[64 * kind + (square ^ 56)];
+    }
+
+    // Init enpassant keys by file
+    for (int square = 0; square < 64; square++)
+        enpassant_keys[square] = polyglot_random[polyglot_enpassant + square % 8];
+
+    // Init castling keys for every combination of castling rights
+    for (int rights = 0; rights < 16; rights++) {
+        castle_keys[rights] = 0ULL;
+
+        for (int flag = 0; flag < 4; flag++)
+            if (rights & (1 << flag)) castle_keys[rights] ^= polyglot_random[polyglot_castle + flag];
+    }
+
+    // Init side key
+    side_key = polyglot_random[polyglot_turn];
+}
+
+// Generate hash key from scratch
+U64 generate_hash_key() {
+    // Final hash key
+    U64 final_key = 0ULL;
+
+    // Loop over piece bitboards
+    for (int piece = P; piece <= k; piece++) {
+        // Init piece bitboard copy
+        U64 bitboard = bitboards[piece];
+
+        // Loop over the pieces within a bitboard
+        while (bitboard) {
+            // Init square occupied by the piece
+            int square = get_ls1b_index(bitboard);
+
+            // Hash piece
+            final_key ^= piece_keys[piece][square];
+
+            // Pop LS1B
+            pop_bit(bitboard, square);
+        }
+    }
+
+    // Hash enpassant
+    if (enpassant != no_sq) final_key ^= enpassant_keys[enpassant];
+
+    // Hash castling rights
+    final_key ^= castle_keys[castle];
+
+    // Hash side to move
+    if (side == white) final_key ^= side_key;
+
+    // Return generated hash key
+    return final_key;
+}
+
 /* ========================================================================= */
 /* =========================== Input & Output ============================== */
 /* ========================================================================= */
@@ -256,134 +653,14 @@ void print_board() {
     printf("     Enpassant:   %s\n", (enpassant != no_sq) ? square_to_coordinates[enpassant] : "no");
     
     // Print castling rights
-    printf("     Castling:  %c%c%c%c\n\n", (castle & wk) ? 'K' : '-',
-                                           (castle & wq) ? 'Q' : '-',
-                                           (castle & bk) ? 'k' : '-',
-                                           (castle & bq) ? 'q' : '-');
-}
-
-// Parse FEN string
-void parse_fen(char *fen) {
-    // Reset board position (bitboards)
-    memset(bitboards, 0ULL, sizeof(bitboards));
-
-    // Reset occupancies (bitboards)
-    memset(occupancies, 0ULL, sizeof(occupancies));
-
-    // Reset game state variables
-    side = 0;
-    enpassant = no_sq;
-    castle = 0;
-
-    // Loop over board ranks
-    for (int rank = 0; rank < 8; rank++) {
-
-        // Loop over board files
-        for (int file = 0; file < 8; file++) {
-            // Init current square
-            int square = rank * 8 + file;
-
-            // Match ascii pieces within FEN string
-            if ((*fen >= 'a' && *fen <= 'z') || (*fen >= 'A' && *fen <= 'Z')) {
-                // Init piece type
-                int piece = char_pieces[*fen];
-
-                // Set piece on corresponding bitboard
-                set_bit(bitboards[piece], square);
-
-                // Increment pointer to FEN string
-                fen++;
-            }
-
-            // Match empty square numbers within FEN string
-            if (*fen >= '0' && *fen <= '9') {
-                // Init offset (convert char 0 to int 0)
-                int offset = *fen - '0';
-
-                // Define piece variable
-                int piece = -1;
-
-                // Loop over all piece bitboards
-                for (int bb_piece = P; bb_piece <= k; bb_piece++) {
-                    // If there is a piece on current square
-                    if (get_bit(bitboards[bb_piece], square))
-                        // Get piece code
-                        piece = bb_piece;
-                }
-
-                // On empty current square
-                if (piece == -1)
-                    // Decrement file
-                    file--;
-
-                // Adjust file counter
-                file += offset;
-
-                // Increment pointer to FEN string
-                fen++;
-            }
-
-            // Match rank separator
-            if (*fen == '/')
-                // Increment pointer to FEN string
-                fen++;
-        }
-    }
-
-    // Got to parsing side to move (increment pointer to FEN string)
-    fen++;
-
-    // Parse side to move
-    (*fen == 'w') ? (side == white) : (side = black);
-
-    // Go to parsing castling rights
-    fen += 2;
-
-    // Parse castling rights
-    while (*fen != ' ') {
-        switch (*fen) {
-            case 'K': castle |= wk; break;
-            case 'Q': castle |= wq; break;
-            case 'k': castle |= bk; break;
-            case 'q': castle |= bq; break;
-            case '-': break;
-        }
-
-        // Increment pointer to FEN string
-        fen++;
-    }
-
-    // Got to parsing enpassant square (increment pointer to FEN string)
-    fen++;
-
-    // Parse enpassant square
-    if (*fen != '-') {
-        // Parse enpassant file & rank
-        int file = fen[0] - 'a';
-        int rank = 8 - (fen[1] - '0');
-
-        // Init enpassant square
-        enpassant = rank * 8 + file;
-    // No enpassant square
-    } else {
-        enpassant = no_sq;
-    }
-
-    // Loop over white pieces bitboards
-    for (int piece = P; piece <= K; piece++) {
-        // Populate white occupancy bitboard
-        occupancies[white] |= bitboards[piece];
-    }
-
-    // Loop over black pieces bitboards
-    for (int piece = p; piece <= k; piece++) {
-        // Populate white occupancy bitboard
-        occupancies[black] |= bitboards[piece];
-    }
-
-    // Init all occupancies
-    occupancies[both] |= occupancies[white];
-    occupancies[both] |= occupancies[black];
+    printf("     Castling:  %c%c%c%c\n", (castle & wk) ? 'K' : '-',
+                                         (castle & wq) ? 'Q' : '-',
+                                         (castle & bk) ? 'k' : '-',
+                                         (castle & bq) ? 'q' : '-');
+
+    // Print halfmove clock & fullmove number
+    printf("     Fifty:     %d\n", fifty);
+    printf("     Fullmove:  %d\n\n", fullmove);
 }
 
 /* ========================================================================= */
@@ -562,26 +839,40 @@ U64 bishop_magic_numbers[64] = {
     0x4010011029020020ULL
 };
 
+// Precomputed attack tables (one block, so it can be mapped from a tables file)
+typedef struct {
+    U64 pawn_attacks[2][64];
+    U64 knight_attacks[64];
+    U64 king_attacks[64];
+    U64 bishop_masks[64];
+    U64 rook_masks[64];
+    U64 bishop_attacks[64][512];
+    U64 rook_attacks[64][4096];
+} attack_tables;
+
+// Attack tables computed in process
+attack_tables attack_storage;
+
 // Pawn attacks table [side][square]
-U64 pawn_attacks[2][64];
+U64 (*pawn_attacks)[64] = attack_storage.pawn_attacks;
 
 // Knight attacks table [square]
-U64 knight_attacks[64];
+U64 *knight_attacks = attack_storage.knight_attacks;
 
 // King attacks table [square]
-U64 king_attacks[64];
+U64 *king_attacks = attack_storage.king_attacks;
 
 // Bishop attack masks
-U64 bishop_masks[64];
+U64 *bishop_masks = attack_storage.bishop_masks;
 
 // Rook attack masks
-U64 rook_masks[64];
+U64 *rook_masks = attack_storage.rook_masks;
 
 // Bishop attacks table [square][occupancies]
-U64 bishop_attacks[64][512];
+U64 (*bishop_attacks)[512] = attack_storage.bishop_attacks;
 
 // Rook attacks tablea [square][occupancies]
-U64 rook_attacks[64][4096];
+U64 (*rook_attacks)[4096] = attack_storage.rook_attacks;
 
 // Generate pawn attacks
 U64 mask_pawn_attacks(int side, int square) {
@@ -1064,9 +1355,389 @@ void print_attacked_squares(int side)
     printf("\n     a b c d e f g h\n\n");
 }
 
-// Generate all moves
-static inline void generate_moves() {
-    
+/*
+          binary move bits                               hexidecimal constants
+
+    0000 0000 0000 0000 0011 1111    source square       0x3f
+    0000 0000 0000 1111 1100 0000    target square       0xfc0
+    0000 0000 1111 0000 0000 0000    piece               0xf000
+    0000 1111 0000 0000 0000 0000    promoted piece      0xf0000
+    0001 0000 0000 0000 0000 0000    capture flag        0x100000
+    0010 0000 0000 0000 0000 0000    double push flag    0x200000
+    0100 0000 0000 0000 0000 0000    enpassant flag      0x400000
+    1000 0000 0000 0000 0000 0000    castling flag       0x800000
+*/
+
+// Encode move
+#define encode_move(source, target, piece, promoted, capture, double, enpassant, castling) \
+    ((source) |             \
+    ((target) << 6) |       \
+    ((piece) << 12) |       \
+    ((promoted) << 16) |    \
+    ((capture) << 20) |     \
+    ((double) << 21) |      \
+    ((enpassant) << 22) |   \
+    ((castling) << 23))
+
+// Extract move parts
+#define get_move_source(move) (move & 0x3f)
+#define get_move_target(move) ((move & 0xfc0) >> 6)
+#define get_move_piece(move) ((move & 0xf000) >> 12)
+#define get_move_promoted(move) ((move & 0xf0000) >> 16)
+#define get_move_capture(move) (move & 0x100000)
+#define get_move_double(move) (move & 0x200000)
+#define get_move_enpassant(move) (move & 0x400000)
+#define get_move_castling(move) (move & 0x800000)
+
+// Move list structure
+typedef struct {
+    // Moves
+    int moves[256];
+
+    // Move count
+    int count;
+} moves;
+
+// Promoted pieces
+char promoted_pieces[] = {
+    [Q] = 'q', [R] = 'r', [B] = 'b', [N] = 'n',
+    [q] = 'q', [r] = 'r', [b] = 'b', [n] = 'n'
+};
+
+// Add move to the move list
+static inline void add_move(moves *move_list, int move) {
+    // Store move
+    move_list->moves[move_list->count] = move;
+
+    // Increment move count
+    move_list->count++;
+}
+
+// Print move (UCI format, null move when there is no move)
+void print_move(int move) {
+    if (!move)
+        printf("0000");
+    else if (get_move_promoted(move))
+        printf("%s%s%c", square_to_coordinates[get_move_source(move)],
+                         square_to_coordinates[get_move_target(move)],
+                         promoted_pieces[get_move_promoted(move)]);
+    else
+        printf("%s%s", square_to_coordinates[get_move_source(move)],
+                       square_to_coordinates[get_move_target(move)]);
+}
+
+// Write move in UCI notation into string (at least 6 bytes)
+void write_move(char *string, int move) {
+    // No move is written as UCI null move
+    if (!move) {
+        strcpy(string, "0000");
+        return;
+    }
+
+    sprintf(string, "%s%s", square_to_coordinates[get_move_source(move)], square_to_coordinates[get_move_target(move)]);
+
+    if (get_move_promoted(move)) {
+        string[4] = promoted_pieces[get_move_promoted(move)];
+        string[5] = '\0';
+    }
+}
+
+// Print move list
+void print_move_list(moves *move_list) {
+    // Do nothing on empty move list
+    if (!move_list->count) {
+        printf("\n     No move in the move list!\n");
+        return;
+    }
+
+    printf("\n     move    piece     capture   double    enpass    castling\n\n");
+
+    // Loop over moves within a move list
+    for (int move_count = 0; move_count < move_list->count; move_count++) {
+        // Init move
+        int move = move_list->moves[move_count];
+
+        printf("     ");
+        print_move(move);
+        printf("%s  %c         %d         %d         %d         %d\n",
+               get_move_promoted(move) ? "" : " ",
+               ascii_pieces[get_move_piece(move)],
+               get_move_capture(move) ? 1 : 0,
+               get_move_double(move) ? 1 : 0,
+               get_move_enpassant(move) ? 1 : 0,
+               get_move_castling(move) ? 1 : 0);
+    }
+
+    // Print total number of moves
+    printf("\n\n     Total number of moves: %d\n\n", move_list->count);
+}
+
+// Preserve board state
+#define copy_board()                                                        \
+    U64 bitboards_copy[12], occupancies_copy[3], hash_key_copy;             \
+    int side_copy, enpassant_copy, castle_copy, fifty_copy, fullmove_copy;  \
+    int repetition_index_copy = repetition_index;                           \
+    memcpy(bitboards_copy, bitboards, 96);                                  \
+    memcpy(occupancies_copy, occupancies, 24);                              \
+    side_copy = side, enpassant_copy = enpassant, castle_copy = castle;     \
+    fifty_copy = fifty, fullmove_copy = fullmove, hash_key_copy = hash_key; \
+
+// Restore board state
+#define take_back()                                                         \
+    memcpy(bitboards, bitboards_copy, 96);                                  \
+    memcpy(occupancies, occupancies_copy, 24);                              \
+    side = side_copy, enpassant = enpassant_copy, castle = castle_copy;     \
+    fifty = fifty_copy, fullmove = fullmove_copy, hash_key = hash_key_copy; \
+    repetition_index = repetition_index_copy;                               \
+
+// Board state with position history (moves a position between threads & contexts)
+typedef struct {
+    U64 bitboards[12];
+    U64 occupancies[3];
+    int side, enpassant, castle, fifty, fullmove;
+    U64 hash_key;
+    U64 repetition_table[max_history];
+    int repetition_index;
+} board_state;
+
+// Store this thread's board state
+void save_board(board_state *state) {
+    memcpy(state->bitboards, bitboards, sizeof(bitboards));
+    memcpy(state->occupancies, occupancies, sizeof(occupancies));
+    state->side = side;
+    state->enpassant = enpassant;
+    state->castle = castle;
+    state->fifty = fifty;
+    state->fullmove = fullmove;
+    state->hash_key = hash_key;
+    memcpy(state->repetition_table, repetition_table, repetition_index * sizeof(U64));
+    state->repetition_index = repetition_index;
+}
+
+// Load board state into this thread
+void load_board(const board_state *state) {
+    memcpy(bitboards, state->bitboards, sizeof(bitboards));
+    memcpy(occupancies, state->occupancies, sizeof(occupancies));
+    side = state->side;
+    enpassant = state->enpassant;
+    castle = state->castle;
+    fifty = state->fifty;
+    fullmove = state->fullmove;
+    hash_key = state->hash_key;
+    memcpy(repetition_table, state->repetition_table, state->repetition_index * sizeof(U64));
+    repetition_index = state->repetition_index;
+}
+
+// Move types
+enum { all_moves, only_captures };
+
+/*
+                           castling   move     in      in
+                              right update     binary  decimal
+
+ king & rooks didn't move:     1111 & 1111  =  1111    15
+
+        white king  moved:     1111 & 1100  =  1100    12
+  white king's rook moved:     1111 & 1110  =  1110    14
+ white queen's rook moved:     1111 & 1101  =  1101    13
+
+         black king moved:     1111 & 0011  =  1011    3
+  black king's rook moved:     1111 & 1011  =  1011    11
+ black queen's rook moved:     1111 & 0111  =  0111    7
+*/
+
+// Castling rights update constants
+const int castling_rights[64] = {
+     7, 15, 15, 15,  3, 15, 15, 11,
+    15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15,
+    13, 15, 15, 15, 12, 15, 15, 14
+};
+
+// Make move on chess board (returns 0 if move leaves own king in check)
+static inline int make_move(int move, int move_flag) {
+    // Quiet moves
+    if (move_flag == all_moves) {
+        // Preserve board state
+        copy_board();
+
+        // Push position key into history
+        repetition_table[repetition_index++] = hash_key;
+
+        // Parse move
+        int source_square = get_move_source(move);
+        int target_square = get_move_target(move);
+        int piece = get_move_piece(move);
+        int promoted_piece = get_move_promoted(move);
+        int capture = get_move_capture(move);
+        int double_push = get_move_double(move);
+        int enpass = get_move_enpassant(move);
+        int castling = get_move_castling(move);
+
+        // Move piece
+        pop_bit(bitboards[piece], source_square);
+        set_bit(bitboards[piece], target_square);
+
+        // Hash piece
+        hash_key ^= piece_keys[piece][source_square];
+        hash_key ^= piece_keys[piece][target_square];
+
+        // Update halfmove clock
+        fifty = (capture || piece == P || piece == p) ? 0 : fifty + 1;
+
+        // Irreversible move, earlier positions can't repeat anymore
+        if (!fifty) repetition_index = 0;
+
+        // Handling capture moves
+        if (capture) {
+            // Pick up bitboard piece index ranges depending on side
+            int start_piece = (side == white) ? p : P;
+            int end_piece = (side == white) ? k : K;
+
+            // Loop over bitboards opposite to the current side to move
+            for (int bb_piece = start_piece; bb_piece <= end_piece; bb_piece++) {
+                // If there's a piece on the target square
+                if (get_bit(bitboards[bb_piece], target_square)) {
+                    // Remove it from corresponding bitboard
+                    pop_bit(bitboards[bb_piece], target_square);
+
+                    // Remove piece from hash key
+                    hash_key ^= piece_keys[bb_piece][target_square];
+                    break;
+                }
+            }
+        }
+
+        // Handle pawn promotions
+        if (promoted_piece) {
+            // Erase the pawn from the target square
+            pop_bit(bitboards[(side == white) ? P : p], target_square);
+            hash_key ^= piece_keys[(side == white) ? P : p][target_square];
+
+            // Set up promoted piece on chess board
+            set_bit(bitboards[promoted_piece], target_square);
+            hash_key ^= piece_keys[promoted_piece][target_square];
+        }
+
+        // Handle enpassant captures
+        if (enpass) {
+            // Erase the pawn depending on side to move
+            if (side == white) {
+                pop_bit(bitboards[p], target_square + 8);
+                hash_key ^= piece_keys[p][target_square + 8];
+            }
+            else {
+                pop_bit(bitboards[P], target_square - 8);
+                hash_key ^= piece_keys[P][target_square - 8];
+            }
+        }
+
+        // Hash enpassant (remove enpassant square from hash key)
+        if (enpassant != no_sq) hash_key ^= enpassant_keys[enpassant];
+
+        // Reset enpassant square
+        enpassant = no_sq;
+
+        // Handle double pawn push
+        if (double_push) {
+            // Set enpassant square depending on side to move
+            enpassant = (side == white) ? target_square + 8 : target_square - 8;
+
+            // Hash enpassant
+            hash_key ^= enpassant_keys[enpassant];
+        }
+
+        // Handle castling moves
+        if (castling) {
+            // Move rook next to the king
+            switch (target_square) {
+                // White castles king side
+                case (g1):
+                    pop_bit(bitboards[R], h1);
+                    set_bit(bitboards[R], f1);
+                    hash_key ^= piece_keys[R][h1] ^ piece_keys[R][f1];
+                    break;
+
+                // White castles queen side
+                case (c1):
+                    pop_bit(bitboards[R], a1);
+                    set_bit(bitboards[R], d1);
+                    hash_key ^= piece_keys[R][a1] ^ piece_keys[R][d1];
+                    break;
+
+                // Black castles king side
+                case (g8):
+                    pop_bit(bitboards[r], h8);
+                    set_bit(bitboards[r], f8);
+                    hash_key ^= piece_keys[r][h8] ^ piece_keys[r][f8];
+                    break;
+
+                // Black castles queen side
+                case (c8):
+                    pop_bit(bitboards[r], a8);
+                    set_bit(bitboards[r], d8);
+                    hash_key ^= piece_keys[r][a8] ^ piece_keys[r][d8];
+                    break;
+            }
+        }
+
+        // Hash castling rights (remove old rights)
+        hash_key ^= castle_keys[castle];
+
+        // Update castling rights
+        castle &= castling_rights[source_square];
+        castle &= castling_rights[target_square];
+
+        // Hash new castling rights
+        hash_key ^= castle_keys[castle];
+
+        // Update occupancies
+        occupancies[white] = bitboards[P] | bitboards[N] | bitboards[B] | bitboards[R] | bitboards[Q] | bitboards[K];
+        occupancies[black] = bitboards[p] | bitboards[n] | bitboards[b] | bitboards[r] | bitboards[q] | bitboards[k];
+        occupancies[both] = occupancies[white] | occupancies[black];
+
+        // Update fullmove number after black's move
+        if (side == black) fullmove++;
+
+        // Change side
+        side ^= 1;
+
+        // Hash side
+        hash_key ^= side_key;
+
+        // Make sure that king has not been exposed into a check
+        if (is_square_attacked((side == white) ? get_ls1b_index(bitboards[k]) : get_ls1b_index(bitboards[K]), side)) {
+            // Take move back
+            take_back();
+
+            // Return illegal move
+            return 0;
+        }
+
+        // Return legal move
+        return 1;
+    }
+
+    // Capture moves
+    else {
+        // Make sure move is the capture
+        if (get_move_capture(move))
+            return make_move(move, all_moves);
+
+        // Otherwise the move is not a capture, don't make it
+        return 0;
+    }
+}
+
+// Generate all pseudo legal moves
+static inline void generate_moves(moves *move_list) {
+    // Init move count
+    move_list->count = 0;
+
     // Define source & target squares
     int source_square, target_square;
 
@@ -1080,47 +1751,8783 @@ static inline void generate_moves() {
 
         // Generate white pawns & white king castling moves
         if (side == white) {
+            // Pick up white pawn bitboards index
+            if (piece == P) {
+                // Loop over white pawns within white pawn bitboard
+                while (bitboard) {
+                    // Init source square
+                    source_square = get_ls1b_index(bitboard);
+
+                    // Init target square
+                    target_square = source_square - 8;
+
+                    // Generate quiet pawn moves
+                    if (!(target_square < a8) && !get_bit(occupancies[both], target_square)) {
+                        // Pawn promotion
+                        if (source_square >= a7 && source_square <= h7) {
+                            add_move(move_list, encode_move(source_square, target_square, piece, Q, 0, 0, 0, 0));
+                            add_move(move_list, encode_move(source_square, target_square, piece, R, 0, 0, 0, 0));
+                            add_move(move_list, encode_move(source_square, target_square, piece, B, 0, 0, 0, 0));
+                            add_move(move_list, encode_move(source_square, target_square, piece, N, 0, 0, 0, 0));
+                        }
+                        else {
+                            // One square ahead pawn move
+                            add_move(move_list, encode_move(source_square, target_square, piece, 0, 0, 0, 0, 0));
+
+                            // Two squares ahead pawn move
+                            if ((source_square >= a2 && source_square <= h2) && !get_bit(occupancies[both], target_square - 8))
+                                add_move(move_list, encode_move(source_square, target_square - 8, piece, 0, 0, 1, 0, 0));
+                        }
+                    }
+
+                    // Init pawn attacks bitboard
+                    attacks = pawn_attacks[side][source_square] & occupancies[black];
+
+                    // Generate pawn captures
+                    while (attacks) {
+                        // Init target square
+                        target_square = get_ls1b_index(attacks);
+
+                        // Pawn promotion
+                        if (source_square >= a7 && source_square <= h7) {
+                            add_move(move_list, encode_move(source_square, target_square, piece, Q, 1, 0, 0, 0));
+                            add_move(move_list, encode_move(source_square, target_square, piece, R, 1, 0, 0, 0));
+                            add_move(move_list, encode_move(source_square, target_square, piece, B, 1, 0, 0, 0));
+                            add_move(move_list, encode_move(source_square, target_square, piece, N, 1, 0, 0, 0));
+                        }
+                        else
+                            // One square ahead pawn move
+                            add_move(move_list, encode_move(source_square, target_square, piece, 0, 1, 0, 0, 0));
+
+                        // Pop LS1B of the pawn attacks
+                        pop_bit(attacks, target_square);
+                    }
+
+                    // Generate enpassant captures
+                    if (enpassant != no_sq) {
+                        // Lookup pawn attacks and bitwise AND with enpassant square (bit)
+                        U64 enpassant_attacks = pawn_attacks[side][source_square] & (1ULL << enpassant);
+
+                        // Make sure enpassant capture available
+                        if (enpassant_attacks) {
+                            // Init enpassant capture target square
+                            int target_enpassant = get_ls1b_index(enpassant_attacks);
+                            add_move(move_list, encode_move(source_square, target_enpassant, piece, 0, 1, 0, 1, 0));
+                        }
+                    }
+
+                    // Pop LS1B from piece bitboard copy
+                    pop_bit(bitboard, source_square);
+                }
+            }
+
+            // Castling moves
+            if (piece == K) {
+                // King side castling is available
+                if (castle & wk) {
+                    // Make sure square between king and king's rook are empty
+                    if (!get_bit(occupancies[both], f1) && !get_bit(occupancies[both], g1)) {
+                        // Make sure king and the f1 squares are not under attacks
+                        if (!is_square_attacked(e1, black) && !is_square_attacked(f1, black))
+                            add_move(move_list, encode_move(e1, g1, piece, 0, 0, 0, 0, 1));
+                    }
+                }
 
+                // Queen side castling is available
+                if (castle & wq) {
+                    // Make sure square between king and queen's rook are empty
+                    if (!get_bit(occupancies[both], d1) && !get_bit(occupancies[both], c1) && !get_bit(occupancies[both], b1)) {
+                        // Make sure king and the d1 squares are not under attacks
+                        if (!is_square_attacked(e1, black) && !is_square_attacked(d1, black))
+                            add_move(move_list, encode_move(e1, c1, piece, 0, 0, 0, 0, 1));
+                    }
+                }
+            }
         }
 
         // Generate black pawns & black king castling moves
+        else {
+            // Pick up black pawn bitboards index
+            if (piece == p) {
+                // Loop over black pawns within black pawn bitboard
+                while (bitboard) {
+                    // Init source square
+                    source_square = get_ls1b_index(bitboard);
+
+                    // Init target square
+                    target_square = source_square + 8;
+
+                    // Generate quiet pawn moves
+                    if (!(target_square > h1) && !get_bit(occupancies[both], target_square)) {
+                        // Pawn promotion
+                        if (source_square >= a2 && source_square <= h2) {
+                            add_move(move_list, encode_move(source_square, target_square, piece, q, 0, 0, 0, 0));
+                            add_move(move_list, encode_move(source_square, target_square, piece, r, 0, 0, 0, 0));
+                            add_move(move_list, encode_move(source_square, target_square, piece, b, 0, 0, 0, 0));
+                            add_move(move_list, encode_move(source_square, target_square, piece, n, 0, 0, 0, 0));
+                        }
+                        else {
+                            // One square ahead pawn move
+                            add_move(move_list, encode_move(source_square, target_square, piece, 0, 0, 0, 0, 0));
+
+                            // Two squares ahead pawn move
+                            if ((source_square >= a7 && source_square <= h7) && !get_bit(occupancies[both], target_square + 8))
+                                add_move(move_list, encode_move(source_square, target_square + 8, piece, 0, 0, 1, 0, 0));
+                        }
+                    }
+
+                    // Init pawn attacks bitboard
+                    attacks = pawn_attacks[side][source_square] & occupancies[white];
+
+                    // Generate pawn captures
+                    while (attacks) {
+                        // Init target square
+                        target_square = get_ls1b_index(attacks);
+
+                        // Pawn promotion
+                        if (source_square >= a2 && source_square <= h2) {
+                            add_move(move_list, encode_move(source_square, target_square, piece, q, 1, 0, 0, 0));
+                            add_move(move_list, encode_move(source_square, target_square, piece, r, 1, 0, 0, 0));
+                            add_move(move_list, encode_move(source_square, target_square, piece, b, 1, 0, 0, 0));
+                            add_move(move_list, encode_move(source_square, target_square, piece, n, 1, 0, 0, 0));
+                        }
+                        else
+                            // One square ahead pawn move
+                            add_move(move_list, encode_move(source_square, target_square, piece, 0, 1, 0, 0, 0));
+
+                        // Pop LS1B of the pawn attacks
+                        pop_bit(attacks, target_square);
+                    }
+
+                    // Generate enpassant captures
+                    if (enpassant != no_sq) {
+                        // Lookup pawn attacks and bitwise AND with enpassant square (bit)
+                        U64 enpassant_attacks = pawn_attacks[side][source_square] & (1ULL << enpassant);
+
+                        // Make sure enpassant capture available
+                        if (enpassant_attacks) {
+                            // Init enpassant capture target square
+                            int target_enpassant = get_ls1b_index(enpassant_attacks);
+                            add_move(move_list, encode_move(source_square, target_enpassant, piece, 0, 1, 0, 1, 0));
+                        }
+                    }
+
+                    // Pop LS1B from piece bitboard copy
+                    pop_bit(bitboard, source_square);
+                }
+            }
+
+            // Castling moves
+            if (piece == k) {
+                // King side castling is available
+                if (castle & bk) {
+                    // Make sure square between king and king's rook are empty
+                    if (!get_bit(occupancies[both], f8) && !get_bit(occupancies[both], g8)) {
+                        // Make sure king and the f8 squares are not under attacks
+                        if (!is_square_attacked(e8, white) && !is_square_attacked(f8, white))
+                            add_move(move_list, encode_move(e8, g8, piece, 0, 0, 0, 0, 1));
+                    }
+                }
+
+                // Queen side castling is available
+                if (castle & bq) {
+                    // Make sure square between king and queen's rook are empty
+                    if (!get_bit(occupancies[both], d8) && !get_bit(occupancies[both], c8) && !get_bit(occupancies[both], b8)) {
+                        // Make sure king and the d8 squares are not under attacks
+                        if (!is_square_attacked(e8, white) && !is_square_attacked(d8, white))
+                            add_move(move_list, encode_move(e8, c8, piece, 0, 0, 0, 0, 1));
+                    }
+                }
+            }
+        }
+
+        // Generate knight moves
+        if ((side == white) ? piece == N : piece == n) {
+            // Loop over source squares of piece bitboard copy
+            while (bitboard) {
+                // Init source square
+                source_square = get_ls1b_index(bitboard);
+
+                // Init piece attacks in order to get set of target squares
+                attacks = knight_attacks[source_square] & ((side == white) ? ~occupancies[white] : ~occupancies[black]);
+
+                // Loop over target squares available from generated attacks
+                while (attacks) {
+                    // Init target square
+                    target_square = get_ls1b_index(attacks);
+
+                    // Quiet move
+                    if (!get_bit(((side == white) ? occupancies[black] : occupancies[white]), target_square))
+                        add_move(move_list, encode_move(source_square, target_square, piece, 0, 0, 0, 0, 0));
+                    // Capture move
+                    else
+                        add_move(move_list, encode_move(source_square, target_square, piece, 0, 1, 0, 0, 0));
+
+                    // Pop LS1B in current attacks set
+                    pop_bit(attacks, target_square);
+                }
+
+                // Pop LS1B of the current piece bitboard copy
+                pop_bit(bitboard, source_square);
+            }
+        }
+
+        // Generate bishop moves
+        if ((side == white) ? piece == B : piece == b) {
+            // Loop over source squares of piece bitboard copy
+            while (bitboard) {
+                // Init source square
+                source_square = get_ls1b_index(bitboard);
+
+                // Init piece attacks in order to get set of target squares
+                attacks = get_bishop_attacks(source_square, occupancies[both]) & ((side == white) ? ~occupancies[white] : ~occupancies[black]);
+
+                // Loop over target squares available from generated attacks
+                while (attacks) {
+                    // Init target square
+                    target_square = get_ls1b_index(attacks);
+
+                    // Quiet move
+                    if (!get_bit(((side == white) ? occupancies[black] : occupancies[white]), target_square))
+                        add_move(move_list, encode_move(source_square, target_square, piece, 0, 0, 0, 0, 0));
+                    // Capture move
+                    else
+                        add_move(move_list, encode_move(source_square, target_square, piece, 0, 1, 0, 0, 0));
+
+                    // Pop LS1B in current attacks set
+                    pop_bit(attacks, target_square);
+                }
+
+                // Pop LS1B of the current piece bitboard copy
+                pop_bit(bitboard, source_square);
+            }
+        }
 
-        //Generate knight moves
+        // Generate rook moves
+        if ((side == white) ? piece == R : piece == r) {
+            // Loop over source squares of piece bitboard copy
+            while (bitboard) {
+                // Init source square
+                source_square = get_ls1b_index(bitboard);
+
+                // Init piece attacks in order to get set of target squares
+                attacks = get_rook_attacks(source_square, occupancies[both]) & ((side == white) ? ~occupancies[white] : ~occupancies[black]);
+
+                // Loop over target squares available from generated attacks
+                while (attacks) {
+                    // Init target square
+                    target_square = get_ls1b_index(attacks);
+
+                    // Quiet move
+                    if (!get_bit(((side == white) ? occupancies[black] : occupancies[white]), target_square))
+                        add_move(move_list, encode_move(source_square, target_square, piece, 0, 0, 0, 0, 0));
+                    // Capture move
+                    else
+                        add_move(move_list, encode_move(source_square, target_square, piece, 0, 1, 0, 0, 0));
+
+                    // Pop LS1B in current attacks set
+                    pop_bit(attacks, target_square);
+                }
 
-        //Generate bishop moves
+                // Pop LS1B of the current piece bitboard copy
+                pop_bit(bitboard, source_square);
+            }
+        }
 
-        //Generate rook moves
+        // Generate queen moves
+        if ((side == white) ? piece == Q : piece == q) {
+            // Loop over source squares of piece bitboard copy
+            while (bitboard) {
+                // Init source square
+                source_square = get_ls1b_index(bitboard);
+
+                // Init piece attacks in order to get set of target squares
+                attacks = get_queen_attacks(source_square, occupancies[both]) & ((side == white) ? ~occupancies[white] : ~occupancies[black]);
+
+                // Loop over target squares available from generated attacks
+                while (attacks) {
+                    // Init target square
+                    target_square = get_ls1b_index(attacks);
+
+                    // Quiet move
+                    if (!get_bit(((side == white) ? occupancies[black] : occupancies[white]), target_square))
+                        add_move(move_list, encode_move(source_square, target_square, piece, 0, 0, 0, 0, 0));
+                    // Capture move
+                    else
+                        add_move(move_list, encode_move(source_square, target_square, piece, 0, 1, 0, 0, 0));
+
+                    // Pop LS1B in current attacks set
+                    pop_bit(attacks, target_square);
+                }
 
-        //Generate queen moves
+                // Pop LS1B of the current piece bitboard copy
+                pop_bit(bitboard, source_square);
+            }
+        }
 
-        //Generate king moves
+        // Generate king moves
+        if ((side == white) ? piece == K : piece == k) {
+            // Loop over source squares of piece bitboard copy
+            while (bitboard) {
+                // Init source square
+                source_square = get_ls1b_index(bitboard);
+
+                // Init piece attacks in order to get set of target squares
+                attacks = king_attacks[source_square] & ((side == white) ? ~occupancies[white] : ~occupancies[black]);
+
+                // Loop over target squares available from generated attacks
+                while (attacks) {
+                    // Init target square
+                    target_square = get_ls1b_index(attacks);
+
+                    // Quiet move
+                    if (!get_bit(((side == white) ? occupancies[black] : occupancies[white]), target_square))
+                        add_move(move_list, encode_move(source_square, target_square, piece, 0, 0, 0, 0, 0));
+                    // Capture move
+                    else
+                        add_move(move_list, encode_move(source_square, target_square, piece, 0, 1, 0, 0, 0));
+
+                    // Pop LS1B in current attacks set
+                    pop_bit(attacks, target_square);
+                }
 
+                // Pop LS1B of the current piece bitboard copy
+                pop_bit(bitboard, source_square);
+            }
+        }
     }
 }
 
-/* ========================================================================== */
-/* ============================== Init all ================================== */
-/* ========================================================================== */
+// Parse UCI move string (e.g. "e7e8q"), returns 0 if the move is not legal
+int parse_move(const char *move_string) {
+    // Create move list instance
+    moves move_list[1];
 
-// Init all variables
-void init_all() {
+    // Generate moves
+    generate_moves(move_list);
+
+    // Parse source & target squares
+    if (move_string[0] < 'a' || move_string[0] > 'h' || move_string[1] < '1' || move_string[1] > '8' ||
+        move_string[2] < 'a' || move_string[2] > 'h' || move_string[3] < '1' || move_string[3] > '8')
+        return 0;
+
+    int source_square = (move_string[0] - 'a') + (8 - (move_string[1] - '0')) * 8;
+    int target_square = (move_string[2] - 'a') + (8 - (move_string[3] - '0')) * 8;
+
+    // Loop over the moves within a move list
+    for (int move_count = 0; move_count < move_list->count; move_count++) {
+        // Init move
+        int move = move_list->moves[move_count];
+
+        // Make sure source & target squares are available within the generated move
+        if (source_square == get_move_source(move) && target_square == get_move_target(move)) {
+            // Init promoted piece
+            int promoted_piece = get_move_promoted(move);
+
+            // Promotion must match the promoted piece character
+            if (promoted_piece && promoted_pieces[promoted_piece] != move_string[4]) continue;
+            if (!promoted_piece && move_string[4] >= 'b' && move_string[4] <= 'r') continue;
+
+            // Make sure the move is legal
+            copy_board();
+            int legal = make_move(move, all_moves);
+            take_back();
+
+            // Return legal move
+            return legal ? move : 0;
+        }
+    }
 
+    // Return illegal move
+    return 0;
 }
 
 /* ====================================================================== */
-/* ============================== Main ================================== */
+/* ============================== Perft ================================= */
 /* ====================================================================== */
 
-int main() {
-    // Init all
-    init_all();
-    
-    // Parse custom FEN string
-    parse_fen(tricky_position);
-    print_board();
+// Leaf nodes (number of positions reached during the test of the move generator at a given depth)
+engine_local long nodes;
 
-    // print all attacked squares on the chess board
-    print_attacked_squares(black);
+// Perft driver
+static inline void perft_driver(int depth) {
+    // Reccursion escape condition
+    if (depth == 0) {
+        // Increment nodes count (count reached positions)
+        nodes++;
+        return;
+    }
 
-    return 0;
-}
\ No newline at end of file
+    // Create move list instance
+    moves move_list[1];
+
+    // Generate moves
+    generate_moves(move_list);
+
+    // Loop over generated moves
+    for (int move_count = 0; move_count < move_list->count; move_count++) {
+        // Preserve board state
+        copy_board();
+
+        // Make move, skip illegal ones
+        if (!make_move(move_list->moves[move_count], all_moves))
+            continue;
+
+        // Call perft driver recursively
+        perft_driver(depth - 1);
+
+        // Take back
+        take_back();
+    }
+}
+
+// Perft test (prints node count for every root move)
+void perft_test(int depth) {
+    printf("\n     Performance test\n\n");
+
+    // Create move list instance
+    moves move_list[1];
+
+    // Generate moves
+    generate_moves(move_list);
+
+    // Init start time & nodes
+    long start = get_time_ms();
+    nodes = 0;
+
+    // Loop over generated moves
+    for (int move_count = 0; move_count < move_list->count; move_count++) {
+        // Preserve board state
+        copy_board();
+
+        // Make move, skip illegal ones
+        if (!make_move(move_list->moves[move_count], all_moves))
+            continue;
+
+        // Cummulative nodes
+        long cummulative_nodes = nodes;
+
+        // Call perft driver recursively
+        perft_driver(depth - 1);
+
+        // Old nodes
+        long old_nodes = nodes - cummulative_nodes;
+
+        // Take back
+        take_back();
+
+        // Print move
+        printf("     move: ");
+        print_move(move_list->moves[move_count]);
+        printf("  nodes: %ld\n", old_nodes);
+    }
+
+    // Print results
+    printf("\n    Depth: %d\n", depth);
+    printf("    Nodes: %ld\n", nodes);
+    printf("     Time: %ld\n\n", get_time_ms() - start);
+}
+
+/* ========================================================================= */
+/* ============================ FEN parsing ================================ */
+/* ========================================================================= */
+
+// FEN buffer size (longest FEN with maximal clocks fits with room to spare)
+#define fen_buffer_size 128
+
+// FEN parser error codes
+enum {
+    fen_ok, fen_bad_placement, fen_bad_rank, fen_bad_kings, fen_bad_pawns,
+    fen_too_many_pieces, fen_bad_side, fen_bad_castling, fen_bad_enpassant,
+    fen_bad_halfmove, fen_bad_fullmove, fen_in_check, fen_trailing
+};
+
+// FEN parser error messages
+const char *fen_errors[] = {
+    "ok",
+    "bad piece placement",
+    "bad rank length",
+    "need exactly one king per side",
+    "pawns on first or last rank or more than 8 per side",
+    "more than 16 pieces per side",
+    "bad side to move",
+    "bad castling rights",
+    "bad enpassant square",
+    "bad halfmove clock",
+    "bad fullmove number",
+    "side not to move is in check",
+    "trailing characters"
+};
+
+// Convert FEN characters to piece codes plus one (0 marks a non piece character)
+const int fen_piece_codes[256] = {
+    ['P'] = P + 1, ['N'] = N + 1, ['B'] = B + 1, ['R'] = R + 1, ['Q'] = Q + 1, ['K'] = K + 1,
+    ['p'] = p + 1, ['n'] = n + 1, ['b'] = b + 1, ['r'] = r + 1, ['q'] = q + 1, ['k'] = k + 1
+};
+
+// FEN record ends at string end or line break
+#define fen_end(c) ((c) == '\0' || (c) == '\n' || (c) == '\r')
+
+// FEN field separator
+#define fen_space(c) ((c) == ' ' || (c) == '\t')
+
+// Parse FEN clock field (returns -1 on bad number)
+static inline int parse_fen_number(const char **fen) {
+    // Init number
+    int number = 0;
+
+    // Number must start with a digit
+    if (**fen < '0' || **fen > '9') return -1;
+
+    // Accumulate digits
+    while (**fen >= '0' && **fen <= '9') {
+        number = number * 10 + (*(*fen)++ - '0');
+
+        // Reject clocks packed positions can't hold (16 bits) instead of overflowing
+        if (number > 65535) return -1;
+    }
+
+    // Return parsed number
+    return number;
+}
+
+// Parse FEN string (returns fen_ok or an error code, board stays untouched on error)
+int parse_fen(const char *fen) {
+    // Parsed piece bitboards
+    U64 pieces[12] = {0ULL};
+
+    // Parsed occupancies
+    U64 occupied[3] = {0ULL};
+
+    // Parsed game state
+    int parsed_side, parsed_castle = 0, parsed_enpassant = no_sq;
+    int parsed_fifty = 0, parsed_fullmove = 1;
+
+    // Current square & file within rank
+    int square = 0, file = 0;
+
+    // Parse piece placement
+    while (1) {
+        // Get next character
+        int c = (unsigned char)*fen++;
+
+        // Match empty square numbers
+        if (c >= '1' && c <= '8') {
+            file += c - '0';
+            square += c - '0';
+
+            // Rank overflow
+            if (file > 8) return fen_bad_rank;
+        }
+
+        // Match rank separator
+        else if (c == '/') {
+            // Rank must be complete and more ranks must follow
+            if (file != 8 || square >= 64) return fen_bad_rank;
+
+            // Start next rank
+            file = 0;
+        }
+
+        // Match end of piece placement
+        else if (c == ' ') break;
+
+        // Match pieces
+        else {
+            // Init piece code
+            int code = fen_piece_codes[c];
+
+            // Unknown character or rank overflow
+            if (!code) return fen_bad_placement;
+            if (file >= 8) return fen_bad_rank;
+
+            // Set piece on corresponding bitboard
+            set_bit(pieces[code - 1], square);
+
+            // Go to next square
+            square++;
+            file++;
+        }
+    }
+
+    // Make sure all 64 squares are covered
+    if (square != 64 || file != 8) return fen_bad_rank;
+
+    // Skip extra separators
+    while (fen_space(*fen)) fen++;
+
+    // Parse side to move
+    if (*fen == 'w') parsed_side = white;
+    else if (*fen == 'b') parsed_side = black;
+    else return fen_bad_side;
+
+    // Side must be followed by separator
+    if (!fen_space(*++fen)) return fen_bad_side;
+    while (fen_space(*fen)) fen++;
+
+    // Parse castling rights
+    if (*fen == '-') fen++;
+    else {
+        while (!fen_space(*fen) && !fen_end(*fen)) {
+            // Init castling flag
+            int flag;
+
+            switch (*fen) {
+                case 'K': flag = wk; break;
+                case 'Q': flag = wq; break;
+                case 'k': flag = bk; break;
+                case 'q': flag = bq; break;
+                default: return fen_bad_castling;
+            }
+
+            // Reject duplicated flags
+            if (parsed_castle & flag) return fen_bad_castling;
+            parsed_castle |= flag;
+
+            // Increment pointer to FEN string
+            fen++;
+        }
+
+        // Reject empty castling field
+        if (!parsed_castle) return fen_bad_castling;
+    }
+
+    // Castling rights must be followed by separator
+    if (!fen_space(*fen)) return fen_bad_castling;
+    while (fen_space(*fen)) fen++;
+
+    // Parse enpassant square
+    if (*fen == '-') fen++;
+    else {
+        // Enpassant rank depends on side to move (6th for white, 3rd for black)
+        if (fen[0] < 'a' || fen[0] > 'h' || fen[1] != (parsed_side == white ? '6' : '3'))
+            return fen_bad_enpassant;
+
+        // Init enpassant square
+        parsed_enpassant = (8 - (fen[1] - '0')) * 8 + (fen[0] - 'a');
+        fen += 2;
+    }
+
+    // Skip separators
+    while (fen_space(*fen)) fen++;
+
+    // Parse optional halfmove clock & fullmove number
+    if (!fen_end(*fen)) {
+        // Parse halfmove clock
+        if ((parsed_fifty = parse_fen_number(&fen)) < 0) return fen_bad_halfmove;
+        while (fen_space(*fen)) fen++;
+
+        // Parse fullmove number (some writers emit 0, treat it as 1)
+        if (!fen_end(*fen)) {
+            if ((parsed_fullmove = parse_fen_number(&fen)) < 0) return fen_bad_fullmove;
+            if (!parsed_fullmove) parsed_fullmove = 1;
+        }
+
+        // Nothing but separators may follow
+        while (fen_space(*fen)) fen++;
+        if (!fen_end(*fen)) return fen_trailing;
+    }
+
+    // Init occupancies
+    for (int piece = P; piece <= K; piece++) occupied[white] |= pieces[piece];
+    for (int piece = p; piece <= k; piece++) occupied[black] |= pieces[piece];
+    occupied[both] = occupied[white] | occupied[black];
+
+    // Exactly one king per side
+    if (count_bits(pieces[K]) != 1 || count_bits(pieces[k]) != 1) return fen_bad_kings;
+
+    // No pawns on first & last ranks, at most 8 pawns per side
+    if ((pieces[P] | pieces[p]) & 0xFF000000000000FFULL) return fen_bad_pawns;
+    if (count_bits(pieces[P]) > 8 || count_bits(pieces[p]) > 8) return fen_bad_pawns;
+
+    // At most 16 pieces per side
+    if (count_bits(occupied[white]) > 16 || count_bits(occupied[black]) > 16) return fen_too_many_pieces;
+
+    // Castling rights need king & rook on their initial squares
+    if ((parsed_castle & (wk | wq)) && !get_bit(pieces[K], e1)) return fen_bad_castling;
+    if ((parsed_castle & (bk | bq)) && !get_bit(pieces[k], e8)) return fen_bad_castling;
+    if ((parsed_castle & wk) && !get_bit(pieces[R], h1)) return fen_bad_castling;
+    if ((parsed_castle & wq) && !get_bit(pieces[R], a1)) return fen_bad_castling;
+    if ((parsed_castle & bk) && !get_bit(pieces[r], h8)) return fen_bad_castling;
+    if ((parsed_castle & bq) && !get_bit(pieces[r], a8)) return fen_bad_castling;
+
+    // Enpassant square needs the double pushed pawn in front of it and empty squares behind
+    if (parsed_enpassant != no_sq) {
+        // Square of the pawn that has just double pushed
+        int pawn_square = parsed_enpassant + (parsed_side == white ? 8 : -8);
+
+        // Square the pawn has started from
+        int start_square = parsed_enpassant - (parsed_side == white ? 8 : -8);
+
+        if (!get_bit(pieces[parsed_side == white ? p : P], pawn_square) ||
+            get_bit(occupied[both], parsed_enpassant) || get_bit(occupied[both], start_square))
+            return fen_bad_enpassant;
+    }
+
+    // Side not to move must not be in check
+    {
+        // Piece code offset of the side to move
+        int offset = parsed_side * 6;
+
+        // King square of the side not to move
+        int king_square = get_ls1b_index(pieces[parsed_side == white ? k : K]);
+
+        // Collect attackers of the side to move
+        U64 attackers = (pawn_attacks[parsed_side ^ 1][king_square] & pieces[P + offset]) |
+                        (knight_attacks[king_square] & pieces[N + offset]) |
+                        (king_attacks[king_square] & pieces[K + offset]) |
+                        (get_bishop_attacks(king_square, occupied[both]) & (pieces[B + offset] | pieces[Q + offset])) |
+                        (get_rook_attacks(king_square, occupied[both]) & (pieces[R + offset] | pieces[Q + offset]));
+
+        if (attackers) return fen_in_check;
+    }
+
+    // Position is valid, init board state
+    memcpy(bitboards, pieces, sizeof(bitboards));
+    memcpy(occupancies, occupied, sizeof(occupancies));
+    side = parsed_side;
+    castle = parsed_castle;
+    enpassant = parsed_enpassant;
+    fifty = parsed_fifty;
+    fullmove = parsed_fullmove;
+
+    // Init hash key & clear position history
+    hash_key = generate_hash_key();
+    repetition_index = 0;
+
+    return fen_ok;
+}
+
+// Write non negative number into FEN buffer
+static inline char *write_fen_number(char *fen, int number) {
+    // Digits in reverse order
+    char digits[12];
+    int count = 0;
+
+    // Extract digits
+    do {
+        digits[count++] = '0' + number % 10;
+        number /= 10;
+    } while (number);
+
+    // Copy digits in correct order
+    while (count) *fen++ = digits[--count];
+
+    return fen;
+}
+
+// Serialize current board state as FEN string (fen must hold fen_buffer_size chars), returns its length
+int to_fen(char *fen) {
+    // Mailbox of piece characters (0 marks empty square)
+    char mailbox[64] = {0};
+
+    // Init FEN writer
+    char *out = fen;
+
+    // Fill mailbox from piece bitboards
+    for (int piece = P; piece <= k; piece++) {
+        // Init piece bitboard copy
+        U64 bitboard = bitboards[piece];
+
+        // Loop over pieces
+        while (bitboard) {
+            int square = get_ls1b_index(bitboard);
+            mailbox[square] = ascii_pieces[piece];
+            pop_bit(bitboard, square);
+        }
+    }
+
+    // Loop over board ranks
+    for (int rank = 0; rank < 8; rank++) {
+        // Empty squares counter
+        int empty = 0;
+
+        // Loop over board files
+        for (int file = 0; file < 8; file++) {
+            // Init square
+            int square = rank * 8 + file;
+
+            // Count empty squares
+            if (!mailbox[square]) {
+                empty++;
+                continue;
+            }
+
+            // Flush empty squares before the piece
+            if (empty) *out++ = '0' + empty;
+            empty = 0;
+
+            // Write piece
+            *out++ = mailbox[square];
+        }
+
+        // Flush empty squares till end of rank
+        if (empty) *out++ = '0' + empty;
+
+        // Write rank separator
+        if (rank < 7) *out++ = '/';
+    }
+
+    // Write side to move
+    *out++ = ' ';
+    *out++ = (side == white) ? 'w' : 'b';
+    *out++ = ' ';
+
+    // Write castling rights
+    if (castle & wk) *out++ = 'K';
+    if (castle & wq) *out++ = 'Q';
+    if (castle & bk) *out++ = 'k';
+    if (castle & bq) *out++ = 'q';
+    if (!castle) *out++ = '-';
+    *out++ = ' ';
+
+    // Write enpassant square
+    if (enpassant != no_sq) {
+        *out++ = square_to_coordinates[enpassant][0];
+        *out++ = square_to_coordinates[enpassant][1];
+    }
+    else *out++ = '-';
+
+    // Write clocks
+    *out++ = ' ';
+    out = write_fen_number(out, fifty);
+    *out++ = ' ';
+    out = write_fen_number(out, fullmove);
+    *out = '\0';
+
+    // Return FEN length
+    return (int)(out - fen);
+}
+
+// Load whole file into zero terminated buffer
+char *read_file(const char *path, long *size) {
+    // Open file
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return NULL;
+
+    // Get file size
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    // Read file contents
+    char *buffer = malloc(*size + 1);
+    if (buffer != NULL && fread(buffer, 1, *size, file) != (size_t)*size) {
+        free(buffer);
+        buffer = NULL;
+    }
+
+    // Terminate buffer
+    if (buffer != NULL) buffer[*size] = '\0';
+
+    fclose(file);
+    return buffer;
+}
+
+// Map whole file read-only, sequential or random access hint (returns 1 on success)
+int map_file(const char *path, const void **data, size_t *size, int sequential) {
+    // Init empty mapping
+    *data = NULL;
+    *size = 0;
+
+    #ifdef WIN64
+        // No mmap, read whole file instead
+        long length;
+        char *buffer = read_file(path, &length);
+        if (buffer == NULL) return 0;
+
+        *data = buffer;
+        *size = length;
+    #else
+        // Open file
+        int descriptor = open(path, O_RDONLY);
+        if (descriptor < 0) return 0;
+
+        // Get file size
+        struct stat status;
+        if (fstat(descriptor, &status) < 0) {
+            close(descriptor);
+            return 0;
+        }
+
+        // Map file (the mapping stays valid after closing descriptor)
+        if (status.st_size) {
+            void *mapping = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+            if (mapping == MAP_FAILED) {
+                close(descriptor);
+                return 0;
+            }
+
+            // Tell kernel how pages are going to be touched
+            madvise(mapping, status.st_size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+
+            *data = mapping;
+            *size = status.st_size;
+        }
+
+        close(descriptor);
+    #endif
+
+    return 1;
+}
+
+// Unmap file mapped by map_file()
+void unmap_file(const void *data, size_t size) {
+    #ifdef WIN64
+        free((void *)data);
+    #else
+        if (size) munmap((void *)data, size);
+    #endif
+}
+
+// FEN parser & serializer throughput benchmark (uses built-in positions without a file)
+int bench_fen(const char *path) {
+    // FEN lines buffer
+    char *buffer;
+    long size = 0;
+
+    // Load FEN lines from file
+    if (path != NULL) {
+        buffer = read_file(path, &size);
+
+        if (buffer == NULL) {
+            printf(" Can't read FEN file %s\n", path);
+            return 1;
+        }
+    }
+
+    // Build buffer from canonical built-in positions
+    else {
+        // Built-in positions
+        const char *positions[] = { start_position, tricky_position, killer_position, cmk_position };
+
+        // Canonical FEN lines
+        char lines[4][fen_buffer_size];
+        int lengths[4];
+        long total = 0;
+
+        // Serialize built-in positions
+        for (int index = 0; index < 4; index++) {
+            if (parse_fen(positions[index]) != fen_ok) {
+                printf(" Bad built-in FEN %s\n", positions[index]);
+                return 1;
+            }
+
+            lengths[index] = to_fen(lines[index]);
+            lines[index][lengths[index]++] = '\n';
+        }
+
+        // Allocate 1M lines
+        buffer = malloc(1000000 * fen_buffer_size + 1);
+        if (buffer == NULL) return 1;
+
+        // Fill buffer
+        for (int line = 0; line < 1000000; line++) {
+            memcpy(buffer + total, lines[line & 3], lengths[line & 3]);
+            total += lengths[line & 3];
+        }
+
+        buffer[total] = '\0';
+        size = total;
+    }
+
+    // End of buffer
+    char *end = buffer + size;
+
+    // Line counters
+    long lines = 0, parsed = 0, mismatches = 0;
+    long errors[fen_trailing + 1] = {0};
+
+    // Time parsing only
+    int start = get_time_ms();
+
+    for (char *line = buffer; line < end; lines++) {
+        // Parse current line
+        int error = parse_fen(line);
+        errors[error]++;
+
+        // Go to next line
+        char *next = memchr(line, '\n', end - line);
+        line = next ? next + 1 : end;
+    }
+
+    int parse_time = get_time_ms() - start;
+
+    // Time parsing & serialization with round trip check
+    char fen[fen_buffer_size];
+    start = get_time_ms();
+
+    for (char *line = buffer; line < end; ) {
+        // Find line end
+        char *next = memchr(line, '\n', end - line);
+        long length = (next ? next : end) - line;
+
+        // Serialize valid positions
+        if (parse_fen(line) == fen_ok) {
+            int fen_length = to_fen(fen);
+            parsed++;
+
+            // Non canonical input lines (e.g. missing clocks) count as mismatches
+            if (fen_length != length || memcmp(fen, line, length)) mismatches++;
+        }
+
+        // Go to next line
+        line = next ? next + 1 : end;
+    }
+
+    int round_trip_time = get_time_ms() - start;
+
+    // Avoid division by zero on tiny inputs
+    if (!parse_time) parse_time = 1;
+    if (!round_trip_time) round_trip_time = 1;
+
+    // Print results
+    printf("\n     Lines:           %ld (%.1f MB)\n", lines, size / 1e6);
+    printf("     Valid:           %ld\n", parsed);
+
+    for (int error = fen_bad_placement; error <= fen_trailing; error++)
+        if (errors[error]) printf("     Rejected:        %ld (%s)\n", errors[error], fen_errors[error]);
+
+    printf("     Parse:           %d ms, %.2f M FEN/s, %.1f MB/s\n",
+           parse_time, lines / (parse_time * 1000.0), size / (parse_time * 1000.0));
+    printf("     Parse + to_fen:  %d ms, %.2f M FEN/s\n",
+           round_trip_time, lines / (round_trip_time * 1000.0));
+    printf("     Non canonical:   %ld\n\n", mismatches);
+
+    free(buffer);
+    return 0;
+}
+
+/* ========================================================================= */
+/* =========================== Packed positions ============================ */
+/* ========================================================================= */
+
+// Packed position: occupancy + one nibble per occupied square in LS1B order (32 bytes, little endian)
+typedef struct {
+    // Occupied squares
+    U64 occupancy;
+
+    // Piece codes of occupied squares, two per byte (low nibble first)
+    unsigned char pieces[16];
+
+    // Side to move (bit 0) & castling rights (bits 1-4)
+    unsigned char state;
+
+    // Enpassant square (no_sq if none)
+    unsigned char enpassant;
+
+    // Halfmove clock & fullmove number
+    unsigned short fifty;
+    unsigned short fullmove;
+
+    // Padding up to 32 bytes
+    unsigned char reserved[2];
+} packed_position;
+
+// Make sure packed position layout is exactly 32 bytes
+typedef char packed_position_size_check[sizeof(packed_position) == 32 ? 1 : -1];
+
+// Pack current board state
+void pack_position(packed_position *packed) {
+    // Init packed position
+    memset(packed, 0, sizeof(packed_position));
+    packed->occupancy = occupancies[both];
+
+    // Nibble index
+    int index = 0;
+
+    // Loop over occupied squares in LS1B order
+    for (U64 occupancy = occupancies[both]; occupancy; occupancy &= occupancy - 1, index++) {
+        // Init square
+        int square = get_ls1b_index(occupancy);
+
+        // Find piece on square
+        int piece = P;
+        while (!get_bit(bitboards[piece], square)) piece++;
+
+        // Store piece code nibble
+        packed->pieces[index >> 1] |= piece << ((index & 1) * 4);
+    }
+
+    // Pack game state
+    packed->state = side | (castle << 1);
+    packed->enpassant = enpassant;
+    packed->fifty = fifty > 65535 ? 65535 : fifty;
+    packed->fullmove = fullmove > 65535 ? 65535 : fullmove;
+}
+
+// Unpack position into board state (returns 1 on success, board stays untouched on failure)
+int unpack_position(const packed_position *packed) {
+    // Corrupted records have more than 32 pieces or bad enpassant square
+    if (count_bits(packed->occupancy) > 32 || packed->enpassant > no_sq) return 0;
+
+    // Decoded piece bitboards
+    U64 pieces[12] = {0ULL};
+
+    // Nibble index
+    int index = 0;
+
+    // Loop over occupied squares in LS1B order
+    for (U64 occupancy = packed->occupancy; occupancy; occupancy &= occupancy - 1, index++) {
+        // Decode piece code nibble
+        int piece = (packed->pieces[index >> 1] >> ((index & 1) * 4)) & 15;
+
+        // Reject unknown piece codes
+        if (piece > k) return 0;
+
+        // Set piece on corresponding bitboard
+        pieces[piece] |= occupancy & -occupancy;
+    }
+
+    // Record is valid, commit board position
+    memcpy(bitboards, pieces, sizeof(bitboards));
+
+    // Init occupancies
+    occupancies[white] = bitboards[P] | bitboards[N] | bitboards[B] | bitboards[R] | bitboards[Q] | bitboards[K];
+    occupancies[black] = bitboards[p] | bitboards[n] | bitboards[b] | bitboards[r] | bitboards[q] | bitboards[k];
+    occupancies[both] = packed->occupancy;
+
+    // Unpack game state
+    side = packed->state & 1;
+    castle = (packed->state >> 1) & 15;
+    enpassant = packed->enpassant;
+    fifty = packed->fifty;
+    fullmove = packed->fullmove;
+
+    // Init hash key & clear position history
+    hash_key = generate_hash_key();
+    repetition_index = 0;
+
+    return 1;
+}
+
+// Read-only view of a packed positions file
+typedef struct {
+    // Packed positions
+    const packed_position *positions;
+
+    // Number of positions
+    long count;
+
+    // Mapped size in bytes
+    size_t size;
+} packed_file;
+
+// Map packed positions file read-only (returns 1 on success)
+int open_packed_file(const char *path, packed_file *file) {
+    // Init empty view
+    memset(file, 0, sizeof(packed_file));
+
+    // Map file, positions are read front to back
+    const void *data;
+    if (!map_file(path, &data, &file->size, 1)) return 0;
+
+    // Init positions & their number
+    file->positions = data;
+    file->count = file->size / sizeof(packed_position);
+
+    return 1;
+}
+
+// Unmap packed positions file
+void close_packed_file(packed_file *file) {
+    unmap_file(file->positions, file->size);
+    memset(file, 0, sizeof(packed_file));
+}
+
+// Convert FEN file to packed positions file
+int pack_fen_file(const char *fen_path, const char *packed_path) {
+    // Load FEN lines
+    long size;
+    char *buffer = read_file(fen_path, &size);
+
+    if (buffer == NULL) {
+        printf(" Can't read FEN file %s\n", fen_path);
+        return 1;
+    }
+
+    // Open packed positions file
+    FILE *file = fopen(packed_path, "wb");
+
+    if (file == NULL) {
+        printf(" Can't write packed file %s\n", packed_path);
+        free(buffer);
+        return 1;
+    }
+
+    // Line counters
+    long lines = 0, packed = 0;
+
+    // Loop over FEN lines
+    for (char *line = buffer, *end = buffer + size; line < end; lines++) {
+        // Pack valid positions
+        if (parse_fen(line) == fen_ok) {
+            packed_position position;
+            pack_position(&position);
+            fwrite(&position, sizeof(position), 1, file);
+            packed++;
+        }
+
+        // Go to next line
+        char *next = memchr(line, '\n', end - line);
+        line = next ? next + 1 : end;
+    }
+
+    fclose(file);
+
+    // Print conversion summary
+    printf("\n     Lines:    %ld\n", lines);
+    printf("     Packed:   %ld\n", packed);
+    printf("     Size:     %ld -> %ld bytes (%.1f%%)\n\n", size, packed * (long)sizeof(packed_position),
+           size ? 100.0 * packed * sizeof(packed_position) / size : 0.0);
+
+    free(buffer);
+    return 0;
+}
+
+// Print packed positions file as FEN lines
+int unpack_to_fen(const char *packed_path) {
+    // Map packed positions
+    packed_file file;
+
+    if (!open_packed_file(packed_path, &file)) {
+        printf(" Can't map packed file %s\n", packed_path);
+        return 1;
+    }
+
+    // FEN output buffer
+    char fen[fen_buffer_size];
+
+    // Loop over positions
+    for (long index = 0; index < file.count; index++) {
+        if (unpack_position(&file.positions[index])) {
+            to_fen(fen);
+            printf("%s\n", fen);
+        }
+        else printf("# corrupted record %ld\n", index);
+    }
+
+    close_packed_file(&file);
+    return 0;
+}
+
+// Packed positions read benchmark (packs built-in positions into a temporary file without a file)
+int bench_pack(const char *packed_path) {
+    // Temporary packed file path
+    char temporary_path[] = "/tmp/chengine-pack-XXXXXX";
+
+    // Build packed file from built-in positions
+    if (packed_path == NULL) {
+        #ifdef WIN64
+            printf(" Usage: chengine bench-pack <file.bin>\n");
+            return 1;
+        #else
+            // Built-in positions
+            const char *positions[] = { start_position, tricky_position, killer_position, cmk_position };
+            packed_position packed[4];
+
+            // Pack built-in positions
+            for (int index = 0; index < 4; index++) {
+                if (parse_fen(positions[index]) != fen_ok) {
+                    printf(" Bad built-in FEN %s\n", positions[index]);
+                    return 1;
+                }
+
+                pack_position(&packed[index]);
+            }
+
+            // Create temporary file
+            int descriptor = mkstemp(temporary_path);
+            if (descriptor < 0) return 1;
+            FILE *file = fdopen(descriptor, "wb");
+
+            // Write 1M positions
+            for (int index = 0; index < 1000000; index++)
+                fwrite(&packed[index & 3], sizeof(packed_position), 1, file);
+
+            fclose(file);
+            packed_path = temporary_path;
+        #endif
+    }
+
+    // Map packed positions
+    packed_file file;
+
+    if (!open_packed_file(packed_path, &file)) {
+        printf(" Can't map packed file %s\n", packed_path);
+        return 1;
+    }
+
+    // Decode counters
+    long decoded = 0, corrupted = 0;
+    U64 checksum = 0ULL;
+
+    // Time decoding straight from mapped pages
+    int start = get_time_ms();
+
+    for (long index = 0; index < file.count; index++) {
+        if (unpack_position(&file.positions[index])) {
+            // Touch board state so decoding can't be optimized away
+            checksum += occupancies[white] ^ bitboards[side ? k : K];
+            decoded++;
+        }
+        else corrupted++;
+    }
+
+    int decode_time = get_time_ms() - start;
+
+    // Measure equivalent FEN text size & parse time
+    char fen[fen_buffer_size];
+    long fen_size = 0;
+    char *fen_buffer = malloc(file.count * fen_buffer_size + 1);
+    if (fen_buffer == NULL) return 1;
+
+    for (long index = 0; index < file.count; index++) {
+        if (unpack_position(&file.positions[index])) {
+            int length = to_fen(fen);
+            memcpy(fen_buffer + fen_size, fen, length);
+            fen_size += length;
+            fen_buffer[fen_size++] = '\n';
+        }
+    }
+
+    fen_buffer[fen_size] = '\0';
+    long rejected = 0;
+    start = get_time_ms();
+
+    for (char *line = fen_buffer, *end = fen_buffer + fen_size; line < end; ) {
+        rejected += parse_fen(line) != fen_ok;
+        line = memchr(line, '\n', end - line) + 1;
+    }
+
+    int parse_time = get_time_ms() - start;
+
+    // Avoid division by zero on tiny inputs
+    if (!decode_time) decode_time = 1;
+    if (!parse_time) parse_time = 1;
+
+    // Print results
+    printf("\n     Positions:     %ld (%ld corrupted)\n", decoded, corrupted);
+    printf("     Packed size:   %zu bytes (%zu per position)\n", file.size, sizeof(packed_position));
+    printf("     FEN size:      %ld bytes (packed is %.1f%% of FEN)\n", fen_size, fen_size ? 100.0 * file.size / fen_size : 0.0);
+    printf("     Decode:        %d ms, %.2f M pos/s, %.2f GB/s\n",
+           decode_time, decoded / (decode_time * 1000.0), file.size / (decode_time * 1e6));
+    printf("     FEN parse:     %d ms, %.2f M pos/s (%ld rejected)\n", parse_time, decoded / (parse_time * 1000.0), rejected);
+    printf("     Checksum:      %llx\n\n", checksum);
+
+    // Clean up
+    free(fen_buffer);
+    close_packed_file(&file);
+    if (packed_path == temporary_path) remove(temporary_path);
+
+    return 0;
+}
+
+/* ======================================================================== */
+/* =========================== Opening book =============================== */
+/* ======================================================================== */
+
+/*
+    Polyglot book: sorted big endian 16-byte entries
+
+        key     8 bytes   position key (see polyglot_key)
+        move    2 bytes   to file (0-2), to row (3-5), from file (6-8), from row (9-11), promotion (12-14)
+        weight  2 bytes   move weight
+        learn   4 bytes   unused
+*/
+
+// Book entry size in bytes
+#define book_entry_size 16
+
+// Book move selection modes
+enum { book_best, book_weighted };
+
+// Mapped book file
+const unsigned char *book_data = NULL;
+
+// Mapped book size & number of entries
+size_t book_size = 0;
+long book_entries = 0;
+
+// Compute Polyglot position key (same as hash key but enpassant only counts when it can be captured)
+U64 polyglot_key() {
+    // Init key
+    U64 key = hash_key;
+
+    // Drop enpassant file if side to move can't actually capture enpassant
+    if (enpassant != no_sq && !(pawn_attacks[side ^ 1][enpassant] & bitboards[side == white ? P : p]))
+        key ^= enpassant_keys[enpassant];
+
+    return key;
+}
+
+// Read big endian number from book
+static inline U64 read_big_endian(const unsigned char *bytes, int count) {
+    // Init number
+    U64 number = 0ULL;
+
+    // Accumulate bytes
+    for (int index = 0; index < count; index++)
+        number = (number << 8) | bytes[index];
+
+    return number;
+}
+
+// Write big endian number into book buffer
+static inline void write_big_endian(unsigned char *bytes, U64 number, int count) {
+    for (int index = count - 1; index >= 0; index--) {
+        bytes[index] = number & 0xFF;
+        number >>= 8;
+    }
+}
+
+// Close opening book
+void book_close() {
+    // Unmap book
+    if (book_data != NULL) unmap_file(book_data, book_size);
+
+    // Reset book
+    book_data = NULL;
+    book_size = 0;
+    book_entries = 0;
+}
+
+// Open opening book (returns 1 on success)
+int book_open(const char *path) {
+    // Close previous book
+    book_close();
+
+    // Map book, probes jump around the file
+    const void *data;
+    if (!map_file(path, &data, &book_size, 0)) return 0;
+
+    // Init book
+    book_data = data;
+    book_entries = book_size / book_entry_size;
+
+    return 1;
+}
+
+// Convert Polyglot move to engine move (returns 0 if it's not legal in current position)
+int decode_book_move(int book_move) {
+    // Parse squares (Polyglot rows count from rank 1)
+    int target_square = (7 - ((book_move >> 3) & 7)) * 8 + (book_move & 7);
+    int source_square = (7 - ((book_move >> 9) & 7)) * 8 + ((book_move >> 6) & 7);
+
+    // Parse promoted piece type (1 knight ... 4 queen)
+    int promoted_type = (book_move >> 12) & 7;
+
+    // Castling is encoded as king captures own rook
+    if (source_square == e1 && get_bit(bitboards[K], e1)) {
+        if (target_square == h1) target_square = g1;
+        else if (target_square == a1) target_square = c1;
+    }
+    else if (source_square == e8 && get_bit(bitboards[k], e8)) {
+        if (target_square == h8) target_square = g8;
+        else if (target_square == a8) target_square = c8;
+    }
+
+    // Create move list instance
+    moves move_list[1];
+
+    // Generate moves
+    generate_moves(move_list);
+
+    // Loop over generated moves
+    for (int move_count = 0; move_count < move_list->count; move_count++) {
+        // Init move
+        int move = move_list->moves[move_count];
+
+        // Match squares & promoted piece type
+        if (get_move_source(move) != source_square || get_move_target(move) != target_square) continue;
+        if ((get_move_promoted(move) ? get_move_promoted(move) % 6 : 0) != promoted_type) continue;
+
+        // Make sure the move is legal
+        copy_board();
+        int legal = make_move(move, all_moves);
+        take_back();
+
+        return legal ? move : 0;
+    }
+
+    // Book move not found
+    return 0;
+}
+
+// Convert engine move to Polyglot move
+int encode_book_move(int move) {
+    // Init squares
+    int source_square = get_move_source(move);
+    int target_square = get_move_target(move);
+
+    // Castling is encoded as king captures own rook
+    if (get_move_castling(move)) {
+        switch (target_square) {
+            case (g1): target_square = h1; break;
+            case (c1): target_square = a1; break;
+            case (g8): target_square = h8; break;
+            case (c8): target_square = a8; break;
+        }
+    }
+
+    // Encode squares (Polyglot rows count from rank 1)
+    int book_move = ((7 - source_square / 8) << 9) | ((source_square % 8) << 6) |
+                    ((7 - target_square / 8) << 3) | (target_square % 8);
+
+    // Encode promoted piece type
+    if (get_move_promoted(move)) book_move |= (get_move_promoted(move) % 6) << 12;
+
+    return book_move;
+}
+
+// Collect legal book moves & weights for current position (returns number of moves)
+int book_probe(moves *move_list, int *weights) {
+    // Init move list
+    move_list->count = 0;
+
+    // No book loaded
+    if (book_data == NULL) return 0;
+
+    // Init position key
+    U64 key = polyglot_key();
+
+    // Binary search for the first entry with the key
+    long low = 0, high = book_entries;
+
+    while (low < high) {
+        long middle = (low + high) / 2;
+
+        if (read_big_endian(book_data + middle * book_entry_size, 8) < key) low = middle + 1;
+        else high = middle;
+    }
+
+    // Loop over entries with the key
+    for (long entry = low; entry < book_entries; entry++) {
+        // Init entry bytes
+        const unsigned char *bytes = book_data + entry * book_entry_size;
+
+        // Entries are sorted by key
+        if (read_big_endian(bytes, 8) != key) break;
+
+        // Skip moves that aren't legal here (key collisions, corrupted entries)
+        int move = decode_book_move((int)read_big_endian(bytes + 8, 2));
+
+        if (move && move_list->count < 256) {
+            weights[move_list->count] = (int)read_big_endian(bytes + 10, 2);
+            add_move(move_list, move);
+        }
+    }
+
+    return move_list->count;
+}
+
+// Pick book move for current position (returns 0 if position is out of book)
+int book_move(int mode) {
+    // Collect book moves
+    moves move_list[1];
+    int weights[256];
+
+    if (!book_probe(move_list, weights)) return 0;
+
+    // Init best move & total weight
+    int best = 0, total = 0;
+
+    for (int index = 0; index < move_list->count; index++) {
+        if (weights[index] > weights[best]) best = index;
+        total += weights[index];
+    }
+
+    // Pick move with highest weight (also when all weights are 0)
+    if (mode == book_best || !total) return move_list->moves[best];
+
+    // Pick move at random proportionally to its weight
+    int pick = get_random_U32_number() % total;
+
+    for (int index = 0; index < move_list->count; index++) {
+        if (pick < weights[index]) return move_list->moves[index];
+        pick -= weights[index];
+    }
+
+    return move_list->moves[best];
+}
+
+// Compare book entries by key & move
+int compare_book_entries(const void *first, const void *second) {
+    // Compare big endian key & move bytes, their memory order equals numeric order
+    return memcmp(first, second, 10);
+}
+
+// Build book from text file with one game per line (UCI moves from start position)
+int make_book(const char *games_path, const char *book_path, int max_plies) {
+    // Load games
+    long size;
+    char *buffer = read_file(games_path, &size);
+
+    if (buffer == NULL) {
+        printf(" Can't read games file %s\n", games_path);
+        return 1;
+    }
+
+    // Book entries being collected
+    long count = 0, capacity = 1 << 16;
+    unsigned char *entries = malloc(capacity * book_entry_size);
+    long games = 0;
+
+    // Loop over games
+    for (char *line = buffer, *end = buffer + size; line < end && entries != NULL; games++) {
+        // Find line end
+        char *next = memchr(line, '\n', end - line);
+        if (next == NULL) next = end;
+
+        // Start new game
+        parse_fen(start_position);
+
+        // Loop over moves within game
+        for (int ply = 0; line < next && ply < max_plies; ply++) {
+            // Skip separators
+            while (line < next && (*line == ' ' || *line == '\t' || *line == '\r')) line++;
+            if (line >= next) break;
+
+            // Stop on illegal or unparsable moves
+            int move = parse_move(line);
+            if (!move) break;
+
+            // Grow entries buffer
+            if (count == capacity) {
+                capacity *= 2;
+                unsigned char *grown = realloc(entries, capacity * book_entry_size);
+
+                if (grown == NULL) {
+                    free(entries);
+                    entries = NULL;
+                    break;
+                }
+
+                entries = grown;
+            }
+
+            // Store entry with weight 1
+            unsigned char *bytes = entries + count++ * book_entry_size;
+            write_big_endian(bytes, polyglot_key(), 8);
+            write_big_endian(bytes + 8, encode_book_move(move), 2);
+            write_big_endian(bytes + 10, 1, 2);
+            write_big_endian(bytes + 12, 0, 4);
+
+            // Play move
+            make_move(move, all_moves);
+
+            // Skip to next move
+            while (line < next && *line != ' ' && *line != '\t') line++;
+        }
+
+        line = next + 1;
+    }
+
+    free(buffer);
+
+    if (entries == NULL) {
+        printf(" Out of memory\n");
+        return 1;
+    }
+
+    // Sort entries by key & move
+    qsort(entries, count, book_entry_size, compare_book_entries);
+
+    // Merge duplicate moves summing their weights
+    long merged = 0;
+
+    for (long entry = 0; entry < count; entry++) {
+        unsigned char *bytes = entries + entry * book_entry_size;
+        unsigned char *last = entries + (merged - 1) * book_entry_size;
+
+        if (merged && !memcmp(last, bytes, 10)) {
+            // Saturate weights
+            int weight = (int)read_big_endian(last + 10, 2) + (int)read_big_endian(bytes + 10, 2);
+            write_big_endian(last + 10, weight > 0xFFFF ? 0xFFFF : weight, 2);
+        }
+        else memmove(entries + merged++ * book_entry_size, bytes, book_entry_size);
+    }
+
+    // Write book
+    FILE *file = fopen(book_path, "wb");
+
+    if (file == NULL) {
+        printf(" Can't write book %s\n", book_path);
+        free(entries);
+        return 1;
+    }
+
+    fwrite(entries, book_entry_size, merged, file);
+    fclose(file);
+
+    printf("\n     Games:     %ld\n", games);
+    printf("     Entries:   %ld (%ld positions x moves seen)\n\n", merged, count);
+
+    free(entries);
+    return 0;
+}
+
+// Print book moves for position and time the probe
+int print_book(const char *book_path, const char *fen) {
+    // Map book
+    if (!book_open(book_path)) {
+        printf(" Can't map book %s\n", book_path);
+        return 1;
+    }
+
+    // Parse position
+    if (parse_fen(fen) != fen_ok) {
+        printf(" Bad FEN\n");
+        return 1;
+    }
+
+    // Collect book moves
+    moves move_list[1];
+    int weights[256];
+    book_probe(move_list, weights);
+
+    printf("\n     Book:      %ld entries\n", book_entries);
+    printf("     Key:       %016llx\n\n", polyglot_key());
+
+    // Print book moves
+    for (int index = 0; index < move_list->count; index++) {
+        printf("     move: ");
+        print_move(move_list->moves[index]);
+        printf("  weight: %d\n", weights[index]);
+    }
+
+    // Time probes
+    int probes = 100000, found = 0;
+    int start = get_time_ms();
+
+    for (int probe = 0; probe < probes; probe++)
+        found += book_move(book_best) != 0;
+
+    int time = get_time_ms() - start;
+
+    printf("\n     Moves:     %d\n", move_list->count);
+    printf("     Probe:     %.2f us (%d probes, %d hits)\n\n", time * 1000.0 / probes, probes, found);
+
+    book_close();
+    return 0;
+}
+
+// Polyglot specification test keys: moves played from the start position & expected key
+struct { const char *moves; U64 key; } polyglot_test_keys[] = {
+    { "", 0x463b96181691fc9cULL },
+    { "e2e4", 0x823c9b50fd114196ULL },
+    { "e2e4 d7d5", 0x0756b94461c50fb0ULL },
+    { "e2e4 d7d5 e4e5", 0x662fafb965db29d4ULL },
+    { "e2e4 d7d5 e4e5 f7f5", 0x22a48b5a8e47ff78ULL },
+    { "e2e4 d7d5 e4e5 f7f5 e1e2", 0x652a607ca3f242c1ULL },
+    { "e2e4 d7d5 e4e5 f7f5 e1e2 e8f7", 0x00fdd303c946bdd9ULL },
+    { "a2a4 b7b5 h2h4 b5b4 c2c4", 0x3c8123ea7b067637ULL },
+    { "a2a4 b7b5 h2h4 b5b4 c2c4 b4c3 a1a3", 0x5c3f9b829b279560ULL },
+};
+
+// Check position keys against the Polyglot specification (returns 1 on mismatch)
+int book_keys() {
+    int count = sizeof(polyglot_test_keys) / sizeof(polyglot_test_keys[0]), failed = 0;
+
+    printf("\n");
+
+    // Loop over test positions
+    for (int test = 0; test < count; test++) {
+        // Play moves from the start position
+        parse_fen(start_position);
+        const char *line = polyglot_test_keys[test].moves;
+
+        while (*line) {
+            int move = parse_move(line);
+            if (!move) break;
+            make_move(move, all_moves);
+
+            // Skip to next move
+            while (*line && *line != ' ') line++;
+            while (*line == ' ') line++;
+        }
+
+        // Compare keys
+        U64 key = polyglot_key();
+        int ok = !*line && key == polyglot_test_keys[test].key;
+        failed += !ok;
+
+        printf("     %016llx  %s  %s\n", key, ok ? "ok  " : "FAIL", *polyglot_test_keys[test].moves ? polyglot_test_keys[test].moves : "startpos");
+    }
+
+    printf("\n     Keys:      %d/%d match\n\n", count - failed, count);
+
+    return failed != 0;
+}
+
+/* ======================================================================== */
+/* =========================== Endgame bitbases =========================== */
+/* ======================================================================== */
+
+/*
+    King & piece vs king bitbases generated by retrograde analysis on first use.
+    Positions are normalized so the strong side is white, one bit per position
+    marks a win for the strong side (anything else is a draw). Pawnless tables
+    keep the strong king within a1-d1-d4 triangle, KPK keeps the pawn on files a-d.
+*/
+
+// Bitbase sizes (positions): side to move x strong king x strong piece x weak king
+#define pawnless_bitbase_size (2 * 10 * 64 * 64)
+#define pawn_bitbase_size (2 * 64 * 32 * 64)
+
+// Get bitbase win bit
+#define get_bitbase_win(bitbase, index) ((bitbase)[(index) >> 6] & (1ULL << ((index) & 63)))
+
+// Win bits for KQK, KRK & KPK
+U64 kqk_bitbase[pawnless_bitbase_size / 64];
+U64 krk_bitbase[pawnless_bitbase_size / 64];
+U64 kpk_bitbase[pawn_bitbase_size / 64];
+
+// Bitbases have been generated
+int bitbases_ready = 0;
+
+#ifndef WIN64
+    // Generation guard, search threads may all probe for the first time at once
+    pthread_once_t bitbases_once = PTHREAD_ONCE_INIT;
+#endif
+
+// Use bitbases in search & evaluation
+int use_bitbases = 1;
+
+// Score of a known win (below mate scores, above any material balance)
+#define known_win 20000
+
+// Bitbase generation states
+enum { bitbase_unknown, bitbase_illegal, bitbase_draw, bitbase_win };
+
+// Strong king squares within a1-d1-d4 triangle
+const int triangle_squares[10] = { a1, b1, c1, d1, b2, c2, d2, c3, d3, d4 };
+
+// Triangle index of a square (-1 outside of triangle)
+const int triangle_index[64] = {
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1,  9, -1, -1, -1, -1,
+    -1, -1,  7,  8, -1, -1, -1, -1,
+    -1,  4,  5,  6, -1, -1, -1, -1,
+     0,  1,  2,  3, -1, -1, -1, -1
+};
+
+// Mirror square along a1-h8 diagonal
+#define transpose_square(square) ((7 - ((square) & 7)) * 8 + (7 - ((square) >> 3)))
+
+// Get bitbase index of a position, folding symmetric positions together
+static inline int get_bitbase_index(int piece, int to_move, int strong_king, int piece_square, int weak_king) {
+    // Pawn endings are only symmetric along files
+    if (piece == P) {
+        // Mirror files so the pawn stands on files a-d
+        if ((piece_square & 7) > 3) {
+            strong_king ^= 7;
+            piece_square ^= 7;
+            weak_king ^= 7;
+        }
+
+        return (to_move << 17) | (strong_king << 11) | (((piece_square >> 3) * 4 + (piece_square & 7)) << 6) | weak_king;
+    }
+
+    // Mirror files so the strong king stands on files a-d
+    if ((strong_king & 7) > 3) {
+        strong_king ^= 7;
+        piece_square ^= 7;
+        weak_king ^= 7;
+    }
+
+    // Mirror ranks so the strong king stands on ranks 1-4
+    if (strong_king < a4) {
+        strong_king ^= 56;
+        piece_square ^= 56;
+        weak_king ^= 56;
+    }
+
+    // Mirror along a1-h8 diagonal so the strong king stands within the triangle
+    if (7 - (strong_king >> 3) > (strong_king & 7)) {
+        strong_king = transpose_square(strong_king);
+        piece_square = transpose_square(piece_square);
+        weak_king = transpose_square(weak_king);
+    }
+
+    return to_move * 40960 + triangle_index[strong_king] * 4096 + piece_square * 64 + weak_king;
+}
+
+// Get position squares from bitbase index
+static inline void decode_bitbase_index(int piece, int index, int *to_move, int *strong_king, int *piece_square, int *weak_king) {
+    if (piece == P) {
+        *to_move = index >> 17;
+        *strong_king = (index >> 11) & 63;
+        *piece_square = ((index >> 8) & 7) * 8 + ((index >> 6) & 3);
+        *weak_king = index & 63;
+    }
+    else {
+        *to_move = index / 40960;
+        *strong_king = triangle_squares[(index / 4096) % 10];
+        *piece_square = (index / 64) % 64;
+        *weak_king = index % 64;
+    }
+}
+
+// Get attacks of the strong piece
+static inline U64 get_bitbase_piece_attacks(int piece, int square, U64 occupancy) {
+    if (piece == Q) return get_queen_attacks(square, occupancy);
+    if (piece == R) return get_rook_attacks(square, occupancy);
+    return pawn_attacks[white][square];
+}
+
+// Check whether position is illegal (overlapping pieces, adjacent kings, misplaced pawn, weak king en prise)
+static inline int is_bitbase_illegal(int piece, int to_move, int strong_king, int piece_square, int weak_king) {
+    // Pieces on the same square
+    if (strong_king == piece_square || strong_king == weak_king || piece_square == weak_king) return 1;
+
+    // Adjacent kings
+    if (get_bit(king_attacks[strong_king], weak_king)) return 1;
+
+    // Pawn on first or last rank
+    if (piece == P && (piece_square <= h8 || piece_square >= a1)) return 1;
+
+    // Side not to move is in check
+    U64 occupancy = (1ULL << strong_king) | (1ULL << piece_square) | (1ULL << weak_king);
+    return to_move == white && get_bit(get_bitbase_piece_attacks(piece, piece_square, occupancy), weak_king);
+}
+
+// Classify position by its successors (weak side needs a single draw, strong side a single win)
+static inline int classify_bitbase_position(unsigned char *states, int piece, int to_move,
+                                            int strong_king, int piece_square, int weak_king) {
+    // Init occupancy & successor counters
+    U64 occupancy = (1ULL << strong_king) | (1ULL << piece_square) | (1ULL << weak_king);
+    int legal_moves = 0, unknown = 0;
+
+    // Weak king to move
+    if (to_move == black) {
+        // Weak king can't step next to the strong king
+        U64 targets = king_attacks[weak_king] & ~king_attacks[strong_king];
+
+        while (targets) {
+            // Init target square
+            int target_square = get_ls1b_index(targets);
+            pop_bit(targets, target_square);
+
+            // Capturing undefended piece draws, defended one can't be captured
+            if (target_square == piece_square) {
+                if (!get_bit(king_attacks[strong_king], piece_square)) return bitbase_draw;
+                continue;
+            }
+
+            // Look up successor
+            int state = states[get_bitbase_index(piece, white, strong_king, piece_square, target_square)];
+            if (state == bitbase_illegal) continue;
+
+            legal_moves++;
+            if (state == bitbase_draw) return bitbase_draw;
+            if (state == bitbase_unknown) unknown = 1;
+        }
+
+        // Checkmate or stalemate
+        if (!legal_moves)
+            return get_bit(get_bitbase_piece_attacks(piece, piece_square, occupancy), weak_king) ?
+                   bitbase_win : bitbase_draw;
+
+        return unknown ? bitbase_unknown : bitbase_win;
+    }
+
+    // Strong king moves
+    U64 targets = king_attacks[strong_king] & ~king_attacks[weak_king] & ~(1ULL << piece_square);
+
+    while (targets) {
+        // Init target square
+        int target_square = get_ls1b_index(targets);
+        pop_bit(targets, target_square);
+
+        // Look up successor
+        int state = states[get_bitbase_index(piece, black, target_square, piece_square, weak_king)];
+        if (state == bitbase_illegal) continue;
+
+        legal_moves++;
+        if (state == bitbase_win) return bitbase_win;
+        if (state == bitbase_unknown) unknown = 1;
+    }
+
+    // Strong piece moves
+    if (piece == P) {
+        // Init push target
+        int target_square = piece_square - 8;
+
+        // Blocked pawn
+        if (!get_bit(occupancy, target_square)) {
+            legal_moves++;
+
+            // Promote to queen or rook (rook avoids stalemate traps), results come from finished bitbases
+            if (target_square <= h8) {
+                if (get_bitbase_win(kqk_bitbase, get_bitbase_index(Q, black, strong_king, target_square, weak_king)) ||
+                    get_bitbase_win(krk_bitbase, get_bitbase_index(R, black, strong_king, target_square, weak_king)))
+                    return bitbase_win;
+            }
+
+            else {
+                // Single push
+                int state = states[get_bitbase_index(P, black, strong_king, target_square, weak_king)];
+                if (state == bitbase_win) return bitbase_win;
+                if (state == bitbase_unknown) unknown = 1;
+
+                // Double push
+                if (piece_square >= a2 && !get_bit(occupancy, target_square - 8)) {
+                    state = states[get_bitbase_index(P, black, strong_king, target_square - 8, weak_king)];
+                    if (state == bitbase_win) return bitbase_win;
+                    if (state == bitbase_unknown) unknown = 1;
+                }
+            }
+        }
+    }
+
+    else {
+        // Queen or rook targets
+        U64 attacks = get_bitbase_piece_attacks(piece, piece_square, occupancy) & ~occupancy;
+
+        while (attacks) {
+            // Init target square
+            int target_square = get_ls1b_index(attacks);
+            pop_bit(attacks, target_square);
+
+            // Look up successor
+            int state = states[get_bitbase_index(piece, black, strong_king, target_square, weak_king)];
+            if (state == bitbase_illegal) continue;
+
+            legal_moves++;
+            if (state == bitbase_win) return bitbase_win;
+            if (state == bitbase_unknown) unknown = 1;
+        }
+    }
+
+    // Stalemate or every move draws
+    if (!legal_moves) return bitbase_draw;
+    return unknown ? bitbase_unknown : bitbase_draw;
+}
+
+// Generate bitbase for king & piece vs king (returns number of iterations)
+int generate_bitbase(U64 *bitbase, int piece) {
+    // Init bitbase size
+    int size = (piece == P) ? pawn_bitbase_size : pawnless_bitbase_size;
+
+    // Position states
+    unsigned char *states = calloc(size, 1);
+    if (states == NULL) return 0;
+
+    // Position squares
+    int to_move, strong_king, piece_square, weak_king;
+
+    // Mark illegal positions
+    for (int index = 0; index < size; index++) {
+        decode_bitbase_index(piece, index, &to_move, &strong_king, &piece_square, &weak_king);
+
+        if (is_bitbase_illegal(piece, to_move, strong_king, piece_square, weak_king))
+            states[index] = bitbase_illegal;
+    }
+
+    // Propagate results backwards from mates, stalemates & captures till nothing changes
+    int iterations = 0, changed = 1;
+
+    while (changed) {
+        changed = 0;
+        iterations++;
+
+        for (int index = 0; index < size; index++) {
+            // Skip classified positions
+            if (states[index] != bitbase_unknown) continue;
+
+            // Classify position by its successors
+            decode_bitbase_index(piece, index, &to_move, &strong_king, &piece_square, &weak_king);
+            int state = classify_bitbase_position(states, piece, to_move, strong_king, piece_square, weak_king);
+
+            if (state != bitbase_unknown) {
+                states[index] = state;
+                changed = 1;
+            }
+        }
+    }
+
+    // Store wins, positions that never resolved are draws
+    memset(bitbase, 0, size / 8);
+
+    for (int index = 0; index < size; index++)
+        if (states[index] == bitbase_win) bitbase[index >> 6] |= 1ULL << (index & 63);
+
+    free(states);
+    return iterations;
+}
+
+// Generate bitbases (promotions in KPK need KQK & KRK)
+void generate_bitbases() {
+    generate_bitbase(kqk_bitbase, Q);
+    generate_bitbase(krk_bitbase, R);
+    generate_bitbase(kpk_bitbase, P);
+
+    __atomic_store_n(&bitbases_ready, 1, __ATOMIC_RELEASE);
+}
+
+// Init bitbases once, threads probing meanwhile wait for generation to finish
+void init_bitbases() {
+    #ifdef WIN64
+        if (!bitbases_ready) generate_bitbases();
+    #else
+        pthread_once(&bitbases_once, generate_bitbases);
+    #endif
+}
+
+// Chebyshev distance between squares
+static inline int square_distance(int square_1, int square_2) {
+    int file_distance = abs(square_1 % 8 - square_2 % 8);
+    int rank_distance = abs(square_1 / 8 - square_2 / 8);
+    return file_distance > rank_distance ? file_distance : rank_distance;
+}
+
+// Manhattan distance from square to board center
+static inline int center_distance(int square) {
+    int file = square % 8, rank = square / 8;
+    return (file < 4 ? 3 - file : file - 4) + (rank < 4 ? 3 - rank : rank - 4);
+}
+
+// Score positions covered by bitbases from side to move point of view (returns 0 if not covered)
+static inline int probe_bitbase(int *score) {
+    // Bitbases cover king & piece vs king only
+    if (count_bits(occupancies[both]) != 3) return 0;
+
+    // Find the third piece
+    int piece = P;
+    while (piece == K || piece == k || !bitboards[piece]) piece++;
+
+    // King & minor piece vs king is a dead draw
+    if (piece % 6 == N || piece % 6 == B) {
+        *score = 0;
+        return 1;
+    }
+
+    // Normalize squares so strong side is white (flip ranks for black)
+    int strong_side = (piece < p) ? white : black;
+    int flip = (strong_side == white) ? 0 : 56;
+    int strong_king = get_ls1b_index(bitboards[strong_side == white ? K : k]) ^ flip;
+    int weak_king = get_ls1b_index(bitboards[strong_side == white ? k : K]) ^ flip;
+    int piece_square = get_ls1b_index(bitboards[piece]) ^ flip;
+    int index = get_bitbase_index(piece % 6, side == strong_side ? white : black, strong_king, piece_square, weak_king);
+
+    // Generate bitbases on first use
+    if (!__atomic_load_n(&bitbases_ready, __ATOMIC_ACQUIRE)) init_bitbases();
+
+    // Pick bitbase
+    U64 *bitbase = (piece % 6 == Q) ? kqk_bitbase : (piece % 6 == R) ? krk_bitbase : kpk_bitbase;
+
+    // Draw
+    if (!get_bitbase_win(bitbase, index)) {
+        *score = 0;
+        return 1;
+    }
+
+    // Win: prefer pushing the pawn, or driving the weak king to the edge next to the strong king
+    int win = known_win + ((piece % 6 == P) ? 20 * (7 - piece_square / 8) :
+                           10 * center_distance(weak_king) + 4 * (14 - 2 * square_distance(strong_king, weak_king)));
+
+    *score = (side == strong_side) ? win : -win;
+    return 1;
+}
+
+// Material signature of the board (piece counts, 4 bits per piece type)
+static inline U64 material_key() {
+    U64 key = 0ULL;
+
+    for (int piece = P; piece <= k; piece++)
+        key |= (U64)count_bits(bitboards[piece]) << (piece * 4);
+
+    return key;
+}
+
+/* ======================================================================== */
+/* ================== Tablebases (private chengine format) ================ */
+/* ======================================================================== */
+
+/*
+    WDL & DTZ tablebases for up to 4 pieces in chengine's own uncompressed
+    format, a pair of files per material signature (e.g. KQvKR.ctbw &
+    KQvKR.ctbz) generated locally by retrograde analysis with "chengine
+    tb-generate". This is NOT Syzygy: Syzygy .rtbw/.rtbz files can't be
+    read here & these files mean nothing to other engines, the TablebasePath
+    option only takes directories written by tb-generate. Probing Syzygy
+    tables would need their compressed block decoder & is not implemented.
+
+    Values borrow Syzygy's conventions: stronger side is stored as white,
+    values are from side to move point of view and DTZ counts plies to the
+    next capture, pawn move or mate. Unlike Syzygy, values ignore the fifty
+    move rule and en passant captures. The WDL cutoff in negamax trusts them
+    anyway, so it is a known source of wrong cutoffs: a win the fifty move
+    rule turns into a draw (or a draw reachable only by an en passant
+    capture) is returned as a plain win. Root DTZ move filtering has the
+    same blind spot.
+
+    File layout:
+
+    tb_header | WDL: 2 bits per position (0 loss, 1 draw, 2 win)
+              | DTZ: 1 byte per position (capped at 255)
+*/
+
+// Max number of pieces (kings included)
+#define tb_max_pieces 4
+
+// Max number of material signatures
+#define tb_max_tables 256
+
+// Table file magic ("CTB1") & version
+#define tb_magic 0x31425443
+#define tb_version 1
+
+// Latency histogram buckets (powers of two nanoseconds)
+#define tb_latency_buckets 24
+
+// Score of tablebase win at root (mate distance is subtracted like with mates)
+#define tb_win_score (known_win + 1000)
+
+// Table kinds
+enum { tb_wdl, tb_dtz };
+
+// WDL values from side to move point of view
+enum { tb_loss = -1, tb_draw, tb_win };
+
+// Table file states
+enum { tb_unloaded, tb_loaded, tb_missing };
+
+// Table file header
+typedef struct {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int kind;
+    unsigned int positions;
+    unsigned char pieces[tb_max_pieces];
+    unsigned char piece_count;
+    unsigned char reserved[11];
+} tb_header;
+
+// Table of one material signature
+typedef struct {
+    // Material signature (e.g. KQvKR) & key
+    char name[16];
+    U64 key;
+
+    // Piece counts & pieces in index order (table orientation, stronger side is white)
+    int counts[12];
+    int pieces[tb_max_pieces];
+    int piece_count;
+
+    // Pawn tables fold files, pawnless tables fold all 8 symmetries
+    int has_pawns;
+
+    // Number of positions (both sides to move)
+    int positions;
+
+    // Mapped WDL & DTZ files
+    const unsigned char *data[2];
+    size_t data_size[2];
+    int state[2];
+} tb_table;
+
+// Known material signatures (count is published once the new table is filled in)
+tb_table tb_tables[tb_max_tables];
+int tb_table_count = 0;
+
+// Table registration & file mapping lock, search threads probe new tables at the same time
+#ifndef WIN64
+    pthread_mutex_t tb_lock = PTHREAD_MUTEX_INITIALIZER;
+    #define tb_lock_tables() pthread_mutex_lock(&tb_lock)
+    #define tb_unlock_tables() pthread_mutex_unlock(&tb_lock)
+#else
+    #define tb_lock_tables()
+    #define tb_unlock_tables()
+#endif
+
+// Tablebase directory (empty disables probing)
+char tb_path[256] = "";
+
+// Probe counters & latency histograms per table kind
+engine_local long tb_probes[2], tb_hits[2];
+engine_local long tb_latency[2][tb_latency_buckets];
+
+// Material values deciding the stronger side
+const int tb_piece_values[6] = { 1, 3, 3, 5, 9, 0 };
+
+// Swap piece color
+#define tb_swap_color(piece) (((piece) + 6) % 12)
+
+// Check whether black is the stronger side (material, then piece counts from queens down)
+static inline int tb_is_flipped(const int *counts) {
+    // Sum material of both sides
+    int white_value = 0, black_value = 0;
+
+    for (int piece = P; piece <= Q; piece++) {
+        white_value += counts[piece] * tb_piece_values[piece];
+        black_value += counts[piece + 6] * tb_piece_values[piece];
+    }
+
+    if (white_value != black_value) return black_value > white_value;
+
+    // Equal material, compare piece counts
+    for (int piece = Q; piece >= P; piece--)
+        if (counts[piece] != counts[piece + 6]) return counts[piece + 6] > counts[piece];
+
+    return 0;
+}
+
+// Init table of given material key
+void tb_init_table(tb_table *table, U64 key) {
+    memset(table, 0, sizeof(tb_table));
+    table->key = key;
+
+    for (int piece = P; piece <= k; piece++)
+        table->counts[piece] = (key >> (piece * 4)) & 15;
+
+    // Init signature
+    char *name = table->name;
+    *name++ = 'K';
+    for (int piece = Q; piece >= P; piece--)
+        for (int count = 0; count < table->counts[piece]; count++) *name++ = ascii_pieces[piece];
+
+    *name++ = 'v';
+    *name++ = 'K';
+    for (int piece = Q; piece >= P; piece--)
+        for (int count = 0; count < table->counts[piece + 6]; count++) *name++ = ascii_pieces[piece];
+
+    // Index order: leading pawn or white king first, then kings, white & black pieces
+    int counts_left[12];
+    memcpy(counts_left, table->counts, sizeof(counts_left));
+    table->has_pawns = table->counts[P] || table->counts[p];
+
+    if (table->has_pawns) {
+        int pawn = table->counts[P] ? P : p;
+        table->pieces[table->piece_count++] = pawn;
+        counts_left[pawn]--;
+    }
+
+    table->pieces[table->piece_count++] = K;
+    table->pieces[table->piece_count++] = k;
+
+    for (int color = white; color <= black; color++)
+        for (int piece = Q; piece >= P; piece--)
+            for (int count = 0; count < counts_left[piece + color * 6]; count++)
+                if (table->piece_count < tb_max_pieces) table->pieces[table->piece_count++] = piece + color * 6;
+
+    // Init number of positions
+    table->positions = 2 * (table->has_pawns ? 32 : 10) << (6 * (table->piece_count - 1));
+}
+
+// Get table of given piece counts (board colors), flip tells whether colors are swapped
+tb_table *tb_get_table(const int *counts, int *flip) {
+    // Init material key in table orientation
+    *flip = tb_is_flipped(counts);
+    U64 key = 0;
+
+    for (int piece = P; piece <= k; piece++)
+        key |= (U64)counts[*flip ? tb_swap_color(piece) : piece] << (piece * 4);
+
+    // Look up known table
+    int count = __atomic_load_n(&tb_table_count, __ATOMIC_ACQUIRE);
+
+    for (int index = 0; index < count; index++)
+        if (tb_tables[index].key == key) return &tb_tables[index];
+
+    // Register new table, another thread may have registered it meanwhile
+    tb_table *table = NULL;
+    tb_lock_tables();
+
+    for (int index = count; index < tb_table_count && table == NULL; index++)
+        if (tb_tables[index].key == key) table = &tb_tables[index];
+
+    if (table == NULL && tb_table_count < tb_max_tables) {
+        table = &tb_tables[tb_table_count];
+        tb_init_table(table, key);
+        __atomic_store_n(&tb_table_count, tb_table_count + 1, __ATOMIC_RELEASE);
+    }
+
+    tb_unlock_tables();
+    return table;
+}
+
+// Get table index of position given by squares in index order (table orientation)
+static inline int tb_index(const tb_table *table, const int *piece_squares, int to_move) {
+    // Mirror files & ranks (ranks for pawnless tables only) so the first piece lands in its folded region
+    int mirror = ((piece_squares[0] & 7) > 3) ? 7 : 0;
+    if (!table->has_pawns && (piece_squares[0] ^ mirror) < a4) mirror ^= 56;
+
+    // Mirror along a1-h8 diagonal so the white king lands within a1-d1-d4 triangle
+    int first_square = piece_squares[0] ^ mirror;
+    int transpose = !table->has_pawns && 7 - (first_square >> 3) > (first_square & 7);
+    if (transpose) first_square = transpose_square(first_square);
+
+    // Init index with side to move & folded first piece
+    int index = to_move * (table->has_pawns ? 32 : 10) +
+                (table->has_pawns ? (first_square >> 3) * 4 + (first_square & 3) : triangle_index[first_square]);
+
+    // Add remaining pieces
+    for (int piece = 1; piece < table->piece_count; piece++) {
+        int square = piece_squares[piece] ^ mirror;
+        index = index * 64 + (transpose ? transpose_square(square) : square);
+    }
+
+    return index;
+}
+
+// Get squares in index order from table index (returns side to move)
+static inline int tb_decode(const tb_table *table, int index, int *piece_squares) {
+    // Remaining pieces
+    for (int piece = table->piece_count - 1; piece > 0; piece--) {
+        piece_squares[piece] = index & 63;
+        index >>= 6;
+    }
+
+    // Folded first piece
+    int base = table->has_pawns ? 32 : 10;
+    int first = index % base;
+    piece_squares[0] = table->has_pawns ? (first >> 2) * 8 + (first & 3) : triangle_squares[first];
+
+    return index / base;
+}
+
+// Get squares of board pieces in index order (returns side to move in table orientation)
+static inline int tb_board_squares(const tb_table *table, int flip, int *piece_squares) {
+    // Pieces not placed yet
+    U64 remaining[12];
+    memcpy(remaining, bitboards, sizeof(remaining));
+
+    for (int index = 0; index < table->piece_count; index++) {
+        // Take next piece of this type
+        int piece = flip ? tb_swap_color(table->pieces[index]) : table->pieces[index];
+        int square = get_ls1b_index(remaining[piece]);
+        pop_bit(remaining[piece], square);
+
+        piece_squares[index] = flip ? square ^ 56 : square;
+    }
+
+    return flip ? side ^ 1 : side;
+}
+
+// Map table file (returns 1 if table file is available), called under the tables lock
+int tb_map(tb_table *table, int kind) {
+    // Another thread got here first
+    if (table->state[kind] != tb_unloaded) return table->state[kind] == tb_loaded;
+
+    // Init file path
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s.%s", tb_path, table->name, kind == tb_wdl ? "ctbw" : "ctbz");
+
+    // Map file, probes jump around randomly
+    const void *data;
+    size_t size;
+
+    // Missing file, mark it only after the failed open so probers never skip a file being mapped
+    if (!map_file(path, &data, &size, 0)) {
+        __atomic_store_n(&table->state[kind], tb_missing, __ATOMIC_RELEASE);
+        return 0;
+    }
+
+    // Reject foreign, stale & truncated files
+    const tb_header *header = data;
+    size_t values_size = (kind == tb_wdl) ? (table->positions + 3) / 4 : table->positions;
+
+    if (size != sizeof(tb_header) + values_size || header->magic != tb_magic || header->version != tb_version ||
+        header->kind != (unsigned int)kind || header->positions != (unsigned int)table->positions) {
+        printf("info string bad tablebase file %s\n", path);
+        unmap_file(data, size);
+        __atomic_store_n(&table->state[kind], tb_missing, __ATOMIC_RELEASE);
+        return 0;
+    }
+
+    // Publish mapping before its state, probers acquire the state first
+    table->data[kind] = data;
+    table->data_size[kind] = size;
+    __atomic_store_n(&table->state[kind], tb_loaded, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+// Map table file on first use (returns 1 if table file is available)
+static inline int tb_load(tb_table *table, int kind) {
+    // File is mapped already or known to be missing
+    int state = __atomic_load_n(&table->state[kind], __ATOMIC_ACQUIRE);
+    if (state != tb_unloaded) return state == tb_loaded;
+
+    tb_lock_tables();
+    int loaded = tb_map(table, kind);
+    tb_unlock_tables();
+
+    return loaded;
+}
+
+// Unmap all table files & forget material signatures
+void tb_close() {
+    for (int index = 0; index < tb_table_count; index++)
+        for (int kind = tb_wdl; kind <= tb_dtz; kind++)
+            if (tb_tables[index].state[kind] == tb_loaded)
+                unmap_file(tb_tables[index].data[kind], tb_tables[index].data_size[kind]);
+
+    tb_table_count = 0;
+}
+
+// Check whether position may be in tablebases
+#define tb_can_probe() (tb_path[0] && count_bits(occupancies[both]) <= tb_max_pieces)
+
+// Probe WDL or DTZ of the position on the board from side to move point of view (returns 1 on hit)
+static inline int tb_probe(int kind, int *value) {
+    // Start latency clock
+    long long start = get_time_ns();
+    int hit = 0;
+
+    // Tables know nothing about castling & en passant captures
+    if (count_bits(occupancies[both]) <= tb_max_pieces && !castle &&
+        (enpassant == no_sq || !(pawn_attacks[side ^ 1][enpassant] & bitboards[side == white ? P : p]))) {
+        // Bare kings
+        if (count_bits(occupancies[both]) == 2) {
+            *value = 0;
+            hit = 1;
+        }
+
+        else {
+            // Count pieces
+            int counts[12], flip;
+            for (int piece = P; piece <= k; piece++) counts[piece] = count_bits(bitboards[piece]);
+
+            // Find table & map its file on first use
+            tb_table *table = tb_get_table(counts, &flip);
+
+            if (table != NULL && tb_load(table, kind)) {
+                // Look up position
+                int piece_squares[tb_max_pieces];
+                int to_move = tb_board_squares(table, flip, piece_squares);
+                int index = tb_index(table, piece_squares, to_move);
+                const unsigned char *values = table->data[kind] + sizeof(tb_header);
+
+                *value = (kind == tb_wdl) ? ((values[index >> 2] >> ((index & 3) * 2)) & 3) - 1 : values[index];
+                hit = 1;
+            }
+        }
+    }
+
+    // Update counters & latency histogram
+    long long latency = get_time_ns() - start;
+    int bucket = 0;
+    while (bucket < tb_latency_buckets - 1 && latency >= (2LL << bucket)) bucket++;
+
+    tb_probes[kind]++;
+    tb_hits[kind] += hit;
+    tb_latency[kind][bucket]++;
+
+    return hit;
+}
+
+// Reset probe counters & latency histograms
+void tb_reset_stats() {
+    memset(tb_probes, 0, sizeof(tb_probes));
+    memset(tb_hits, 0, sizeof(tb_hits));
+    memset(tb_latency, 0, sizeof(tb_latency));
+}
+
+// Print probe counters & latency histograms
+void tb_print_stats() {
+    for (int kind = tb_wdl; kind <= tb_dtz; kind++) {
+        printf("\n     %s probes: %ld  hits: %ld  misses: %ld\n", kind == tb_wdl ? "WDL" : "DTZ",
+               tb_probes[kind], tb_hits[kind], tb_probes[kind] - tb_hits[kind]);
+
+        // Latency buckets holding any probes
+        for (int bucket = 0; bucket < tb_latency_buckets; bucket++)
+            if (tb_latency[kind][bucket])
+                printf("     %8lld ns %s %10ld  %5.1f%%\n", 1LL << bucket,
+                       bucket == tb_latency_buckets - 1 ? "and up" : "      ",
+                       tb_latency[kind][bucket], 100.0 * tb_latency[kind][bucket] / tb_probes[kind]);
+    }
+
+    printf("\n");
+}
+
+// Pick root move by DTZ, fastest zeroing when winning, slowest when losing (returns 0 if not in tables or drawn)
+int tb_root_move(int *score) {
+    // Root must be in tablebases
+    int root_wdl;
+    if (!tb_can_probe() || !tb_probe(tb_wdl, &root_wdl)) return 0;
+
+    // Best move, its result & distance to zeroing
+    int best_root_move = 0, best_wdl = tb_loss - 1, best_distance = 0;
+
+    // Generate moves
+    moves move_list[1];
+    generate_moves(move_list);
+
+    // Loop over moves
+    for (int count = 0; count < move_list->count; count++) {
+        int move = move_list->moves[count];
+
+        // Preserve board state
+        copy_board();
+
+        // Skip illegal moves
+        if (!make_move(move, all_moves)) continue;
+
+        // Look up result & DTZ after the move, give up on any miss
+        int wdl, dtz;
+        int found = tb_probe(tb_wdl, &wdl) && tb_probe(tb_dtz, &dtz);
+
+        // Restore board state
+        take_back();
+
+        if (!found) return 0;
+
+        // Result for the side to move, plies to zeroing (mate comes first, any capture or pawn move resets)
+        wdl = -wdl;
+        int zeroing = get_move_capture(move) || get_move_piece(move) == P || get_move_piece(move) == p;
+        int distance = (wdl == tb_win && dtz == 0) ? 0 : zeroing ? 1 : dtz + 1;
+
+        // Prefer better result, then shorter win or longer loss
+        if (wdl > best_wdl || (wdl == best_wdl && ((wdl == tb_win && distance < best_distance) ||
+                                                   (wdl == tb_loss && distance > best_distance)))) {
+            best_root_move = move;
+            best_wdl = wdl;
+            best_distance = distance;
+        }
+    }
+
+    // Drawn root is left to search, its tablebase cutoffs keep the draw
+    if (best_wdl == tb_draw) return 0;
+
+    // Score like mates: closer wins score higher
+    *score = best_wdl * (tb_win_score - best_distance);
+
+    return best_root_move;
+}
+
+// Retrograde generation state
+typedef struct {
+    // Table being generated
+    tb_table *table;
+
+    // Position states, resolving pass (WDL) or DTZ plus one (DTZ), positions to examine next pass
+    unsigned char *state;
+    unsigned short *level;
+    unsigned char *dirty;
+
+    // Smaller table was missing
+    int failed;
+} tb_generator;
+
+// Generation states
+enum { tb_state_unknown, tb_state_illegal, tb_state_draw, tb_state_win, tb_state_loss };
+
+// Set board from squares in index order (table orientation)
+static inline void tb_set_board(const tb_table *table, const int *piece_squares, int to_move) {
+    // Reset board
+    memset(bitboards, 0ULL, sizeof(bitboards));
+    memset(occupancies, 0ULL, sizeof(occupancies));
+
+    // Place pieces
+    for (int index = 0; index < table->piece_count; index++) {
+        set_bit(bitboards[table->pieces[index]], piece_squares[index]);
+        set_bit(occupancies[table->pieces[index] < p ? white : black], piece_squares[index]);
+    }
+
+    occupancies[both] = occupancies[white] | occupancies[black];
+
+    // Init game state
+    side = to_move;
+    enpassant = no_sq;
+    castle = 0;
+    fifty = 0;
+}
+
+// Check whether position on the board is illegal (overlapping pieces, pawns on first or last rank, side not to move in check)
+static inline int tb_is_illegal(const tb_table *table) {
+    if (count_bits(occupancies[both]) != table->piece_count) return 1;
+    if ((bitboards[P] | bitboards[p]) & 0xff000000000000ffULL) return 1;
+
+    return is_square_attacked(get_ls1b_index(bitboards[side == white ? k : K]), side);
+}
+
+// Get generation state of the board position reached by a move (conversions look up smaller tables)
+static inline int tb_successor_state(tb_generator *generator, int conversion, int *index) {
+    // Capture or promotion leaves the table
+    if (conversion) {
+        *index = -1;
+
+        int wdl;
+        if (!tb_probe(tb_wdl, &wdl)) {
+            generator->failed = 1;
+            return tb_state_draw;
+        }
+
+        return (wdl == tb_win) ? tb_state_win : (wdl == tb_loss) ? tb_state_loss : tb_state_draw;
+    }
+
+    // Look up position within the table
+    int piece_squares[tb_max_pieces];
+    tb_board_squares(generator->table, 0, piece_squares);
+    *index = tb_index(generator->table, piece_squares, side);
+
+    return generator->state[*index];
+}
+
+// Classify position on the board by its successors (sets mated flag on checkmate)
+static inline int tb_classify_wdl(tb_generator *generator, int *mated) {
+    // Successor counters
+    int legal_moves = 0, draw = 0, unknown = 0;
+    *mated = 0;
+
+    // Generate moves
+    moves move_list[1];
+    generate_moves(move_list);
+
+    for (int count = 0; count < move_list->count; count++) {
+        int move = move_list->moves[count];
+
+        // Preserve board state
+        copy_board();
+
+        // Skip illegal moves
+        if (!make_move(move, all_moves)) continue;
+        legal_moves++;
+
+        // Look up successor
+        int index;
+        int state = tb_successor_state(generator, get_move_capture(move) || get_move_promoted(move), &index);
+
+        // Restore board state
+        take_back();
+
+        // Single move into a lost position wins
+        if (state == tb_state_loss) return tb_state_win;
+        if (state == tb_state_draw) draw = 1;
+        else if (state != tb_state_win) unknown = 1;
+    }
+
+    // Checkmate or stalemate
+    if (!legal_moves) {
+        *mated = is_square_attacked(get_ls1b_index(bitboards[side == white ? K : k]), side ^ 1);
+        return *mated ? tb_state_loss : tb_state_draw;
+    }
+
+    // Loss needs every move to lose
+    return unknown ? tb_state_unknown : draw ? tb_state_draw : tb_state_loss;
+}
+
+// Check whether DTZ of won or lost position on the board is known at given pass
+static inline int tb_classify_dtz(tb_generator *generator, int won, int pass) {
+    // Generate moves
+    moves move_list[1];
+    generate_moves(move_list);
+
+    for (int count = 0; count < move_list->count; count++) {
+        int move = move_list->moves[count];
+
+        // Preserve board state
+        copy_board();
+
+        // Skip illegal moves
+        if (!make_move(move, all_moves)) continue;
+
+        // Captures & pawn moves reset the counter
+        int conversion = get_move_capture(move) || get_move_promoted(move);
+        int zeroing = conversion || get_move_piece(move) == P || get_move_piece(move) == p;
+
+        // Look up successor & its DTZ known before this pass
+        int index;
+        int state = tb_successor_state(generator, conversion, &index);
+        int known = index >= 0 && generator->level[index] && generator->level[index] <= pass;
+
+        // Restore board state
+        take_back();
+
+        // Winner needs a zeroing move keeping the win or a move into a loss with known DTZ
+        if (won && state == tb_state_loss && (zeroing || known)) return 1;
+
+        // Loser needs DTZ of all non zeroing moves
+        if (!won && !zeroing && !known) return 0;
+    }
+
+    return !won;
+}
+
+// Mark positions moving into given one for the next pass (retrograde moves, over-approximated)
+static inline void tb_mark_predecessors(tb_generator *generator, int index) {
+    // Decode position
+    const tb_table *table = generator->table;
+    int piece_squares[tb_max_pieces];
+    int to_move = tb_decode(table, index, piece_squares);
+
+    // Init occupancy
+    U64 occupancy = 0ULL;
+    for (int piece = 0; piece < table->piece_count; piece++) set_bit(occupancy, piece_squares[piece]);
+
+    // Loop over pieces of the side that just moved
+    for (int piece = 0; piece < table->piece_count; piece++) {
+        int piece_code = table->pieces[piece];
+        if ((piece_code < p ? white : black) == to_move) continue;
+
+        // Init source squares
+        int square = piece_squares[piece];
+        U64 sources = 0ULL;
+
+        switch (piece_code % 6) {
+            // Pawns step back (double steps from second rank)
+            case P:
+                if (piece_code == P) {
+                    if (square + 8 < a1 && !get_bit(occupancy, square + 8)) {
+                        set_bit(sources, square + 8);
+                        if (square >= a4 && square <= h4 && !get_bit(occupancy, square + 16)) set_bit(sources, square + 16);
+                    }
+                }
+
+                else if (square - 8 > h8 && !get_bit(occupancy, square - 8)) {
+                    set_bit(sources, square - 8);
+                    if (square >= a5 && square <= h5 && !get_bit(occupancy, square - 16)) set_bit(sources, square - 16);
+                }
+                break;
+
+            // Pieces move back the way they move forward
+            case N: sources = knight_attacks[square] & ~occupancy; break;
+            case B: sources = get_bishop_attacks(square, occupancy) & ~occupancy; break;
+            case R: sources = get_rook_attacks(square, occupancy) & ~occupancy; break;
+            case Q: sources = get_queen_attacks(square, occupancy) & ~occupancy; break;
+            case K: sources = king_attacks[square] & ~occupancy; break;
+        }
+
+        while (sources) {
+            // Move piece back
+            int source_square = get_ls1b_index(sources);
+            pop_bit(sources, source_square);
+            piece_squares[piece] = source_square;
+
+            generator->dirty[tb_index(table, piece_squares, to_move ^ 1)] = 1;
+
+            // Diagonal twins of pawnless positions fold to different indices
+            if (!table->has_pawns) {
+                int twin_squares[tb_max_pieces];
+
+                for (int twin = 0; twin < table->piece_count; twin++)
+                    twin_squares[twin] = transpose_square(piece_squares[twin]);
+
+                generator->dirty[tb_index(table, twin_squares, to_move ^ 1)] = 1;
+            }
+        }
+
+        // Restore piece square
+        piece_squares[piece] = square;
+    }
+}
+
+// Write table file (returns 1 on success)
+int tb_write(const tb_table *table, int kind, const unsigned char *values, size_t size) {
+    // Init header
+    tb_header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = tb_magic;
+    header.version = tb_version;
+    header.kind = kind;
+    header.positions = table->positions;
+    header.piece_count = table->piece_count;
+
+    for (int piece = 0; piece < table->piece_count; piece++) header.pieces[piece] = table->pieces[piece];
+
+    // Init file path
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s.%s", tb_path, table->name, kind == tb_wdl ? "ctbw" : "ctbz");
+
+    // Write header & values
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) return 0;
+
+    int written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(values, 1, size, file) == size;
+    return fclose(file) == 0 && written;
+}
+
+// Generate WDL & DTZ files of a table, smaller tables reached by captures & promotions first (returns 1 on success)
+int tb_generate(tb_table *table) {
+    // Table files exist already
+    if (tb_load(table, tb_wdl) && tb_load(table, tb_dtz)) return 1;
+
+    // Loop over pieces that can be captured or promote
+    for (int piece = P; piece <= k; piece++) {
+        if (piece == K || piece == k || !table->counts[piece]) continue;
+
+        // Smaller material: capture, promotion, capture with promotion
+        for (int promoted = -1; promoted <= Q; promoted++) {
+            if (promoted == P || (promoted >= 0 && piece % 6 != P)) continue;
+
+            for (int captured = -1; captured <= k; captured++) {
+                if (promoted < 0 && captured >= 0) continue;
+
+                // Init smaller material counts
+                int counts[12], flip;
+                memcpy(counts, table->counts, sizeof(counts));
+                counts[piece]--;
+
+                if (promoted >= 0) {
+                    counts[promoted + (piece < p ? 0 : 6)]++;
+
+                    // Pawn captures an enemy piece while promoting
+                    if (captured >= 0) {
+                        if ((captured < p) == (piece < p) || captured % 6 == K || !counts[captured]) continue;
+                        counts[captured]--;
+                    }
+                }
+
+                // Bare kings need no table
+                int pieces = 0;
+                for (int count = P; count <= k; count++) pieces += counts[count];
+                if (pieces == 2) continue;
+
+                tb_table *smaller = tb_get_table(counts, &flip);
+                if (smaller == NULL || !tb_generate(smaller)) return 0;
+            }
+        }
+    }
+
+    // Init generation state
+    int start = get_time_ms();
+    int positions = table->positions;
+
+    tb_generator generator[1] = {{ table, calloc(positions, 1), calloc(positions, 2), calloc(positions, 1), 0 }};
+    unsigned char *mates = calloc(positions, 1);
+    unsigned char *values = calloc(positions, 1);
+
+    if (generator->state == NULL || generator->level == NULL || generator->dirty == NULL || mates == NULL || values == NULL) {
+        printf(" Out of memory generating %s\n", table->name);
+        generator->failed = 1;
+    }
+
+    // Mark illegal positions, examine all others on the first pass
+    int piece_squares[tb_max_pieces];
+
+    for (int index = 0; index < positions && !generator->failed; index++) {
+        tb_set_board(table, piece_squares, tb_decode(table, index, piece_squares));
+
+        if (tb_is_illegal(table)) generator->state[index] = tb_state_illegal;
+        else generator->dirty[index] = 1;
+    }
+
+    // Resolve wins & losses backwards from mates & conversions (mates get DTZ zero right away)
+    int wdl_passes = 0, resolved = !generator->failed;
+
+    while (resolved && !generator->failed) {
+        resolved = 0;
+        wdl_passes++;
+
+        for (int index = 0; index < positions; index++) {
+            // Examine positions with changed successors only
+            if (!generator->dirty[index]) continue;
+            generator->dirty[index] = 0;
+            if (generator->state[index] != tb_state_unknown) continue;
+
+            // Classify position
+            int mated;
+            tb_set_board(table, piece_squares, tb_decode(table, index, piece_squares));
+            int state = tb_classify_wdl(generator, &mated);
+            if (state == tb_state_unknown) continue;
+
+            generator->state[index] = state;
+            mates[index] = mated;
+
+            // Wins & losses propagate to predecessors
+            if (state != tb_state_draw) {
+                generator->level[index] = wdl_passes;
+                resolved++;
+            }
+        }
+
+        // Examine predecessors of positions resolved on this pass
+        if (resolved)
+            for (int index = 0; index < positions; index++)
+                if (generator->level[index] == wdl_passes) tb_mark_predecessors(generator, index);
+    }
+
+    // Unresolved positions are draws, mates have DTZ zero
+    for (int index = 0; index < positions && !generator->failed; index++) {
+        if (generator->state[index] == tb_state_unknown) generator->state[index] = tb_state_draw;
+        generator->level[index] = mates[index];
+        generator->dirty[index] = generator->state[index] == tb_state_win || generator->state[index] == tb_state_loss;
+    }
+
+    // Resolve DTZ pass by pass: DTZ of positions resolved on pass N is N
+    int dtz_passes = 0;
+    resolved = !generator->failed;
+
+    while (resolved && !generator->failed) {
+        resolved = 0;
+        dtz_passes++;
+
+        for (int index = 0; index < positions; index++) {
+            // Examine positions with changed successors only
+            if (!generator->dirty[index]) continue;
+            generator->dirty[index] = 0;
+            if (generator->level[index] || (generator->state[index] != tb_state_win && generator->state[index] != tb_state_loss)) continue;
+
+            // Check whether DTZ is known now
+            tb_set_board(table, piece_squares, tb_decode(table, index, piece_squares));
+
+            if (tb_classify_dtz(generator, generator->state[index] == tb_state_win, dtz_passes)) {
+                generator->level[index] = dtz_passes + 1;
+                resolved++;
+            }
+        }
+
+        // Examine predecessors of positions resolved on this pass
+        if (resolved)
+            for (int index = 0; index < positions; index++)
+                if (generator->level[index] == dtz_passes + 1) tb_mark_predecessors(generator, index);
+    }
+
+    // Count results
+    int wins = 0, draws = 0, losses = 0, max_dtz = 0;
+
+    for (int index = 0; index < positions && !generator->failed; index++) {
+        int state = generator->state[index];
+        wins += state == tb_state_win;
+        draws += state == tb_state_draw;
+        losses += state == tb_state_loss;
+        if (generator->level[index] > max_dtz + 1) max_dtz = generator->level[index] - 1;
+    }
+
+    // Write WDL file (illegal positions read as draws)
+    int written = !generator->failed;
+
+    if (written) {
+        for (int index = 0; index < positions; index++) {
+            int state = generator->state[index];
+            int wdl = (state == tb_state_win) ? 2 : (state == tb_state_loss) ? 0 : 1;
+            values[index >> 2] |= wdl << ((index & 3) * 2);
+        }
+
+        written = tb_write(table, tb_wdl, values, (positions + 3) / 4);
+    }
+
+    // Write DTZ file
+    if (written) {
+        for (int index = 0; index < positions; index++) {
+            int dtz = generator->level[index] ? generator->level[index] - 1 : 0;
+            values[index] = dtz > 255 ? 255 : dtz;
+        }
+
+        written = tb_write(table, tb_dtz, values, positions);
+    }
+
+    // Map new files on next probe
+    table->state[tb_wdl] = table->state[tb_dtz] = tb_unloaded;
+
+    printf("     %-8s %9d positions  %9d wins %9d draws %9d losses  %3d/%3d passes  max DTZ %3d  %6d ms%s\n",
+           table->name, positions, wins, draws, losses, wdl_passes, dtz_passes, max_dtz,
+           get_time_ms() - start, written ? "" : "  FAILED");
+
+    // Free generation state
+    free(generator->state);
+    free(generator->level);
+    free(generator->dirty);
+    free(mates);
+    free(values);
+
+    return written;
+}
+
+// Generate tables for material signatures like KQvKR (returns 0 on success)
+int tb_generate_tables(const char *path, char **names, int count) {
+    // Generated files go to tablebase directory
+    snprintf(tb_path, sizeof(tb_path), "%s", path);
+    printf("\n");
+
+    for (int index = 0; index < count; index++) {
+        // Parse signature: kings, white pieces, "v", black pieces
+        const char *name = names[index];
+        int counts[12] = { [K] = 1, [k] = 1 }, color = -1, pieces = 0, flip;
+
+        for (; *name; name++) {
+            if (*name == 'K') color++;
+            else if (*name == 'v' && color == white) continue;
+            else if (strchr("QRBNP", *name) && color >= white) counts[char_pieces[(int)*name] + color * 6]++, pieces++;
+            else break;
+        }
+
+        if (*name || color != black || pieces < 1 || pieces > tb_max_pieces - 2) {
+            printf(" Bad material %s (up to %d pieces, like KQvKR)\n", names[index], tb_max_pieces);
+            return 1;
+        }
+
+        // Generate table & smaller ones it depends on
+        tb_table *table = tb_get_table(counts, &flip);
+        if (table == NULL || !tb_generate(table)) return 1;
+    }
+
+    printf("\n");
+    tb_reset_stats();
+    return 0;
+}
+
+/* ======================================================================== */
+/* ============================= Evaluation =============================== */
+/* ======================================================================== */
+
+// Material score [piece]
+int material_score[12] = {
+    100,      // white pawn score
+    300,      // white knight score
+    350,      // white bishop score
+    500,      // white rook score
+   1000,      // white queen score
+  10000,      // white king score
+   -100,      // black pawn score
+   -300,      // black knight score
+   -350,      // black bishop score
+   -500,      // black rook score
+  -1000,      // black queen score
+ -10000,      // black king score
+};
+
+// Pawn positional score
+int pawn_score[64] = {
+    90,  90,  90,  90,  90,  90,  90,  90,
+    30,  30,  30,  40,  40,  30,  30,  30,
+    20,  20,  20,  30,  30,  30,  20,  20,
+    10,  10,  10,  20,  20,  10,  10,  10,
+     5,   5,  10,  20,  20,   5,   5,   5,
+     0,   0,   0,   5,   5,   0,   0,   0,
+     0,   0,   0, -10, -10,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0
+};
+
+// Knight positional score
+int knight_score[64] = {
+    -5,   0,   0,   0,   0,   0,   0,  -5,
+    -5,   0,   0,  10,  10,   0,   0,  -5,
+    -5,   5,  20,  20,  20,  20,   5,  -5,
+    -5,  10,  20,  30,  30,  20,  10,  -5,
+    -5,  10,  20,  30,  30,  20,  10,  -5,
+    -5,   5,  20,  10,  10,  20,   5,  -5,
+    -5,   0,   0,   0,   0,   0,   0,  -5,
+    -5, -10,   0,   0,   0,   0, -10,  -5
+};
+
+// Bishop positional score
+int bishop_score[64] = {
+     0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,  10,  10,   0,   0,   0,
+     0,   0,  10,  20,  20,  10,   0,   0,
+     0,   0,  10,  20,  20,  10,   0,   0,
+     0,  10,   0,   0,   0,   0,  10,   0,
+     0,  30,   0,   0,   0,   0,  30,   0,
+     0,   0, -10,   0,   0, -10,   0,   0
+};
+
+// Rook positional score
+int rook_score[64] = {
+    50,  50,  50,  50,  50,  50,  50,  50,
+    50,  50,  50,  50,  50,  50,  50,  50,
+     0,   0,  10,  20,  20,  10,   0,   0,
+     0,   0,  10,  20,  20,  10,   0,   0,
+     0,   0,  10,  20,  20,  10,   0,   0,
+     0,   0,  10,  20,  20,  10,   0,   0,
+     0,   0,  10,  20,  20,  10,   0,   0,
+     0,   0,   0,  20,  20,   0,   0,   0
+};
+
+// King positional score
+int king_score[64] = {
+     0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   5,   5,   5,   5,   0,   0,
+     0,   5,   5,  10,  10,   5,   5,   0,
+     0,   5,  10,  20,  20,  10,   5,   0,
+     0,   5,  10,  20,  20,  10,   5,   0,
+     0,   0,   5,  10,  10,   5,   0,   0,
+     0,   5,   5,  -5,  -5,   0,   5,   0,
+     0,   0,   5,   0, -15,   0,  10,   0
+};
+
+// Position evaluation (score from side to move point of view)
+static inline int evaluate() {
+    // Static evaluation score
+    int score = 0;
+
+    // Bitbase draws are exact, wins add a known win bonus on top of the evaluation
+    int bitbase_score = 0;
+    if (use_bitbases && probe_bitbase(&bitbase_score) && !bitbase_score) return 0;
+
+    // Loop over piece bitboards
+    for (int bb_piece = P; bb_piece <= k; bb_piece++) {
+        // Init piece bitboard copy
+        U64 bitboard = bitboards[bb_piece];
+
+        // Loop over pieces within a bitboard
+        while (bitboard) {
+            // Init square
+            int square = get_ls1b_index(bitboard);
+
+            // Score material weights
+            score += material_score[bb_piece];
+
+            // Score positional piece scores (black squares are mirrored vertically)
+            switch (bb_piece) {
+                // Evaluate white pieces
+                case P: score += pawn_score[square]; break;
+                case N: score += knight_score[square]; break;
+                case B: score += bishop_score[square]; break;
+                case R: score += rook_score[square]; break;
+                case K: score += king_score[square]; break;
+
+                // Evaluate black pieces
+                case p: score -= pawn_score[square ^ 56]; break;
+                case n: score -= knight_score[square ^ 56]; break;
+                case b: score -= bishop_score[square ^ 56]; break;
+                case r: score -= rook_score[square ^ 56]; break;
+                case k: score -= king_score[square ^ 56]; break;
+            }
+
+            // Pop LS1B
+            pop_bit(bitboard, square);
+        }
+    }
+
+    // Return final evaluation based on side
+    return ((side == white) ? score : -score) + bitbase_score;
+}
+
+/* ======================================================================== */
+/* ================================= NUMA ================================= */
+/* ======================================================================== */
+
+/*
+    Topology comes from /sys/devices/system/node (one node with all allowed
+    CPUs elsewhere). Search threads are pinned round-robin over nodes, so
+    thread i runs on node i % nodes. Thread stacks (holding thread local
+    board & search state & move lists) prefer their thread's node, the
+    shared hash table is interleaved over all nodes, or when the kernel
+    refuses memory policies, cleared in slices by threads pinned to every
+    node so first touch spreads its pages.
+*/
+
+// Topology limits
+#define max_numa_nodes 16
+#define max_node_cpus 256
+
+// Linux memory policies (see mbind(2))
+#define mpol_preferred 1
+#define mpol_interleave 3
+
+// Detected nodes, their kernel ids & allowed CPUs
+int numa_node_count = 0;
+int numa_node_ids[max_numa_nodes];
+int numa_cpu_counts[max_numa_nodes];
+int numa_cpus[max_numa_nodes][max_node_cpus];
+
+// Pin search threads & place memory on nodes
+int use_numa_pinning = 1;
+
+#ifdef __linux__
+    // CPUs this process may run on
+    cpu_set_t allowed_cpus;
+#endif
+
+// Parse kernel CPU list like "0-3,8-11" (returns number of CPUs)
+int parse_cpu_list(const char *list, int *cpus, int max_cpus) {
+    int count = 0;
+
+    while (*list >= '0' && *list <= '9') {
+        // Parse single CPU or range
+        char *end;
+        int first = strtol(list, &end, 10), last = first;
+        if (*end == '-') last = strtol(end + 1, &end, 10);
+
+        for (int cpu = first; cpu <= last && count < max_cpus; cpu++) cpus[count++] = cpu;
+
+        // Next list item
+        list = (*end == ',') ? end + 1 : end;
+    }
+
+    return count;
+}
+
+// Detect NUMA nodes & their CPUs once
+void detect_numa_topology() {
+    if (numa_node_count) return;
+
+    #ifdef __linux__
+        // Keep only CPUs allowed by affinity (containers & taskset)
+        CPU_ZERO(&allowed_cpus);
+        sched_getaffinity(0, sizeof(allowed_cpus), &allowed_cpus);
+
+        for (int node = 0; node < 64 && numa_node_count < max_numa_nodes; node++) {
+            char path[64], list[4096];
+            snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+
+            FILE *file = fopen(path, "r");
+            if (file == NULL) continue;
+
+            if (fgets(list, sizeof(list), file)) {
+                int cpus[max_node_cpus], count = parse_cpu_list(list, cpus, max_node_cpus), allowed = 0;
+
+                for (int index = 0; index < count; index++)
+                    if (CPU_ISSET(cpus[index], &allowed_cpus)) numa_cpus[numa_node_count][allowed++] = cpus[index];
+
+                // Skip nodes without usable CPUs
+                if (allowed) {
+                    numa_node_ids[numa_node_count] = node;
+                    numa_cpu_counts[numa_node_count++] = allowed;
+                }
+            }
+
+            fclose(file);
+        }
+    #endif
+
+    // No topology info: one node with all allowed CPUs (CPU 0 without affinity support)
+    if (!numa_node_count) {
+        #ifdef __linux__
+            for (int cpu = 0; cpu < CPU_SETSIZE && numa_cpu_counts[0] < max_node_cpus; cpu++)
+                if (CPU_ISSET(cpu, &allowed_cpus)) numa_cpus[0][numa_cpu_counts[0]++] = cpu;
+        #endif
+
+        if (!numa_cpu_counts[0]) numa_cpus[0][numa_cpu_counts[0]++] = 0;
+        numa_node_ids[0] = 0;
+        numa_node_count = 1;
+    }
+}
+
+// Node of search thread (round-robin over nodes)
+static inline int thread_node(int thread) {
+    return thread % numa_node_count;
+}
+
+// CPU of search thread (next free CPU of its node, wrapping when threads outnumber CPUs)
+static inline int thread_cpu(int thread) {
+    int node = thread_node(thread);
+    return numa_cpus[node][(thread / numa_node_count) % numa_cpu_counts[node]];
+}
+
+// Pin calling thread to CPU of search thread (returns 0 if not supported)
+int pin_thread(int thread) {
+    #ifdef __linux__
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(thread_cpu(thread), &cpus);
+        return !pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    #else
+        return 0;
+    #endif
+}
+
+// Let calling thread run on all allowed CPUs again
+void unpin_thread() {
+    #ifdef __linux__
+        pthread_setaffinity_np(pthread_self(), sizeof(allowed_cpus), &allowed_cpus);
+    #endif
+}
+
+// Apply memory policy to pages of memory range not touched yet (returns 0 on failure)
+int bind_memory(void *memory, size_t size, int mode, unsigned long node_mask) {
+    #ifdef __linux__
+        // Policies apply to whole pages
+        uintptr_t page = sysconf(_SC_PAGESIZE);
+        uintptr_t start = ((uintptr_t)memory + page - 1) & ~(page - 1);
+        uintptr_t end = ((uintptr_t)memory + size) & ~(page - 1);
+        if (end <= start) return 0;
+
+        return !syscall(SYS_mbind, start, end - start, mode, &node_mask, 8 * sizeof(node_mask), 0);
+    #else
+        return 0;
+    #endif
+}
+
+// Node mask of all detected nodes
+unsigned long all_nodes_mask() {
+    unsigned long mask = 0;
+    for (int node = 0; node < numa_node_count; node++) mask |= 1UL << numa_node_ids[node];
+    return mask;
+}
+
+#ifndef WIN64
+
+// Slice of memory to clear from a pinned thread
+typedef struct {
+    int node;
+    char *memory;
+    size_t size;
+} memory_slice;
+
+// Clear slice from a thread running on slice's node
+void *clear_slice(void *argument) {
+    memory_slice *slice = argument;
+    pin_thread(slice->node);
+    memset(slice->memory, 0, slice->size);
+    return NULL;
+}
+
+#endif
+
+// Zero fresh memory spread over NUMA nodes: interleaved pages or first touch by every node
+void clear_distributed(void *memory, size_t size) {
+    #ifndef WIN64
+        if (numa_node_count > 1 && use_numa_pinning && !bind_memory(memory, size, mpol_interleave, all_nodes_mask())) {
+            memory_slice slices[max_numa_nodes];
+            pthread_t threads[max_numa_nodes];
+            int started[max_numa_nodes];
+            size_t slice_size = size / numa_node_count;
+
+            // Thread pinned to each node touches its slice first (node index doubles as search thread index)
+            for (int node = 0; node < numa_node_count; node++) {
+                slices[node] = (memory_slice){ node, (char *)memory + node * slice_size,
+                                               node == numa_node_count - 1 ? size - node * slice_size : slice_size };
+                started[node] = !pthread_create(&threads[node], NULL, clear_slice, &slices[node]);
+                if (!started[node]) memset(slices[node].memory, 0, slices[node].size);
+            }
+
+            for (int node = 0; node < numa_node_count; node++)
+                if (started[node]) pthread_join(threads[node], NULL);
+
+            return;
+        }
+    #endif
+
+    memset(memory, 0, size);
+}
+
+/* ======================================================================== */
+/* ========================= Transposition table ========================== */
+/* ======================================================================== */
+
+// Hash table size in MB
+#define hash_size_default 16
+
+// No hash entry found constant
+#define no_hash_entry 100000
+
+// Transposition table hash flags
+#define hash_flag_exact 0
+#define hash_flag_alpha 1
+#define hash_flag_beta 2
+
+// Transposition table data structure
+typedef struct {
+    U64 hash_key;   // "almost" unique chess position identifier
+    int depth;      // current search depth
+    int flag;       // flag the type of node (fail-low/fail-high/PV)
+    int score;      // score (alpha/beta/PV)
+    int best_move;  // best move found in position
+} tt;
+
+// Define transposition table instance
+engine_local tt *hash_table = NULL;
+
+// Number of transposition table entries
+engine_local int hash_entries = 0;
+
+// Clear transposition table
+void clear_hash_table() {
+    memset(hash_table, 0, hash_entries * sizeof(tt));
+}
+
+// Dynamically allocate memory for transposition table
+void init_hash_table(int mb) {
+    // Free hash table if not empty
+    if (hash_table != NULL) free(hash_table);
+
+    // Init number of hash entries
+    hash_entries = (int)((mb * 0x100000LL) / sizeof(tt));
+
+    // Allocate memory
+    hash_table = malloc(hash_entries * sizeof(tt));
+
+    // Retry with half the size if allocation fails
+    if (hash_table == NULL) {
+        printf("    Couldn't allocate memory for hash table, trying %dMB...\n", mb / 2);
+        init_hash_table(mb / 2);
+    }
+
+    // Clear table spreading its pages over NUMA nodes
+    else clear_distributed(hash_table, hash_entries * sizeof(tt));
+}
+
+/* ======================================================================== */
+/* ============================== Telemetry =============================== */
+/* ======================================================================== */
+
+/*
+    Search counters live in a per thread struct bumped without atomics and
+    merged when a search is reported as a single JSON line. Build with
+    -DNO_TELEMETRY to compile every counter out.
+*/
+
+// Max iterations recorded per search
+#define max_iterations 64
+
+// Search counters of one thread
+typedef struct {
+    // Quiescence nodes (negamax nodes are counted by "nodes")
+    long qnodes;
+
+    // Hash table probes, probes finding the position & probes returning a score
+    long tt_probes;
+    long tt_hits;
+    long tt_cutoffs;
+
+    // Beta cutoffs & those caused by the first legal move
+    long beta_cutoffs;
+    long first_move_cutoffs;
+
+    // Null window scouts of later moves & their full window re-searches
+    long pvs_scouts;
+    long pvs_researches;
+
+    // Reduced searches beating alpha
+    long lmr_researches;
+
+    // Aspiration window searches & their failures
+    long aspiration_searches;
+    long aspiration_fail_lows;
+    long aspiration_fail_highs;
+} search_stats;
+
+// Iterative deepening iteration record (counters are totals since search start)
+typedef struct {
+    int depth;
+    int score;
+    int time;
+    long nodes;
+    search_stats stats;
+} iteration_stats;
+
+// Counters of the searching thread
+engine_local search_stats stats;
+
+// Iterations of the current search
+engine_local iteration_stats iterations[max_iterations];
+engine_local int iteration_count;
+
+// Totals a Lazy SMP helper publishes after each of its iterations
+typedef struct {
+    long nodes;
+    search_stats stats;
+} thread_totals;
+
+// Helper totals of the running parallel search (main thread) & own published totals (helper thread)
+engine_local thread_totals *helper_totals;
+engine_local int helper_totals_count;
+engine_local thread_totals *published_totals;
+
+#ifndef WIN64
+    // Guards published helper totals
+    pthread_mutex_t totals_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+// Bump counter of the searching thread
+#ifdef NO_TELEMETRY
+    #define count_stat(counter)
+#else
+    #define count_stat(counter) (stats.counter++)
+#endif
+
+// Add counters of one thread to the totals
+void merge_stats(search_stats *total, const search_stats *thread) {
+    total->qnodes += thread->qnodes;
+    total->tt_probes += thread->tt_probes;
+    total->tt_hits += thread->tt_hits;
+    total->tt_cutoffs += thread->tt_cutoffs;
+    total->beta_cutoffs += thread->beta_cutoffs;
+    total->first_move_cutoffs += thread->first_move_cutoffs;
+    total->pvs_scouts += thread->pvs_scouts;
+    total->pvs_researches += thread->pvs_researches;
+    total->lmr_researches += thread->lmr_researches;
+    total->aspiration_searches += thread->aspiration_searches;
+    total->aspiration_fail_lows += thread->aspiration_fail_lows;
+    total->aspiration_fail_highs += thread->aspiration_fail_highs;
+}
+
+// Reset counters & iterations before a search
+void reset_stats() {
+    memset(&stats, 0, sizeof(stats));
+    iteration_count = 0;
+}
+
+// Record finished iteration with counters merged over threads
+void record_iteration(int depth, int score, int time) {
+    if (iteration_count == max_iterations) return;
+
+    iteration_stats *iteration = &iterations[iteration_count++];
+    memset(iteration, 0, sizeof(iteration_stats));
+    iteration->depth = depth;
+    iteration->score = score;
+    iteration->time = time;
+    iteration->nodes = nodes;
+    merge_stats(&iteration->stats, &stats);
+
+    #ifndef WIN64
+        if (published_totals == NULL && !helper_totals_count) return;
+
+        // Helpers publish their totals, main thread adds the latest totals of every helper
+        pthread_mutex_lock(&totals_lock);
+
+        if (published_totals != NULL) {
+            published_totals->nodes = nodes;
+            published_totals->stats = stats;
+        }
+
+        else {
+            for (int helper = 0; helper < helper_totals_count; helper++) {
+                iteration->nodes += helper_totals[helper].nodes;
+                merge_stats(&iteration->stats, &helper_totals[helper].stats);
+            }
+        }
+
+        pthread_mutex_unlock(&totals_lock);
+    #endif
+}
+
+// Safe ratio for reports
+#define ratio(numerator, denominator) ((denominator) ? (double)(numerator) / (denominator) : 0.0)
+
+// Print search record as JSON on a single "info string" line
+void print_telemetry(int move) {
+    #ifndef NO_TELEMETRY
+        if (!iteration_count) return;
+
+        // Totals come from the last iteration
+        const iteration_stats *last = &iterations[iteration_count - 1];
+        const search_stats *total = &last->stats;
+
+        // Effective branching factor: node growth of the last iteration over the one before
+        long last_nodes = last->nodes - (iteration_count > 1 ? iterations[iteration_count - 2].nodes : 0);
+        long previous_nodes = (iteration_count > 2) ? iterations[iteration_count - 2].nodes - iterations[iteration_count - 3].nodes :
+                              (iteration_count > 1) ? iterations[0].nodes : 0;
+        double ebf = ratio(last_nodes, previous_nodes);
+
+        // Best move in UCI notation
+        char move_string[6];
+        write_move(move_string, move);
+
+        printf("info string telemetry {\"bestmove\":\"%s\",\"depth\":%d,\"score\":%d,\"time_ms\":%d,"
+               "\"nodes\":%ld,\"qnodes\":%ld,\"nps\":%.0f,\"tt_probes\":%ld,\"tt_hits\":%ld,\"tt_hit_rate\":%.4f,"
+               "\"tt_cutoffs\":%ld,\"beta_cutoffs\":%ld,\"first_move_cutoffs\":%ld,\"first_move_cutoff_rate\":%.4f,"
+               "\"pvs_scouts\":%ld,\"pvs_researches\":%ld,\"lmr_researches\":%ld,\"aspiration_searches\":%ld,"
+               "\"aspiration_fail_lows\":%ld,\"aspiration_fail_highs\":%ld,\"ebf\":%.3f,\"iterations\":[",
+               move_string, last->depth, last->score, last->time, last->nodes, total->qnodes,
+               ratio(last->nodes, last->time) * 1000.0, total->tt_probes, total->tt_hits,
+               ratio(total->tt_hits, total->tt_probes), total->tt_cutoffs, total->beta_cutoffs,
+               total->first_move_cutoffs, ratio(total->first_move_cutoffs, total->beta_cutoffs),
+               total->pvs_scouts, total->pvs_researches, total->lmr_researches, total->aspiration_searches,
+               total->aspiration_fail_lows, total->aspiration_fail_highs, ebf);
+
+        // Per iteration counters
+        for (int index = 0; index < iteration_count; index++) {
+            const iteration_stats *iteration = &iterations[index];
+            const iteration_stats *previous = index ? &iterations[index - 1] : NULL;
+            long previous_nodes = previous ? previous->nodes : 0;
+            long previous_iteration_nodes = (index > 1) ? previous->nodes - iterations[index - 2].nodes : previous_nodes;
+
+            printf("%s{\"depth\":%d,\"score\":%d,\"time_ms\":%d,\"nodes\":%ld,\"qnodes\":%ld,\"ebf\":%.3f}",
+                   index ? "," : "", iteration->depth, iteration->score,
+                   iteration->time - (previous ? previous->time : 0), iteration->nodes - previous_nodes,
+                   iteration->stats.qnodes - (previous ? previous->stats.qnodes : 0),
+                   ratio(iteration->nodes - previous_nodes, previous_iteration_nodes));
+        }
+
+        printf("]}\n");
+    #else
+        (void)move;
+    #endif
+}
+
+/* ======================================================================== */
+/* =============================== Search ================================= */
+/* ======================================================================== */
+
+/*
+    Score bounds:
+
+    [-infinity, -mate_value ... -mate_score, ... score ... mate_score ... mate_value, infinity]
+*/
+
+#define infinity 50000
+#define mate_value 49000
+#define mate_score 48000
+
+// Max ply that we can reach within a search
+#define max_ply 64
+
+// Half move counter
+engine_local int ply;
+
+// Material signature of the search root
+engine_local U64 root_material;
+
+// Best move found at root
+engine_local int best_move;
+
+// Time control: search has a deadline, soft limit for starting new iterations & hard stop time
+engine_local int time_set;
+engine_local int soft_time;
+engine_local int stop_time;
+
+// Node limit (0 for none)
+engine_local long node_limit;
+
+// Search was stopped by time control, node limit or main thread (helpers)
+engine_local int stopped;
+
+// Main thread is done, helper threads stop
+int search_abort;
+
+// Safety margin for engine communication in milliseconds
+#define move_overhead 30
+
+// Default number of moves left without "movestogo"
+#define default_moves_to_go 30
+
+// Killer moves [id][ply]
+engine_local int killer_moves[2][max_ply];
+
+// History moves [piece][square]
+engine_local int history_moves[12][64];
+
+// Principal variation length [ply]
+engine_local int pv_length[max_ply];
+
+// Principal variation table [ply][ply]
+engine_local int pv_table[max_ply][max_ply];
+
+// Max principal variations reported by MultiPV
+#define max_multi_pv 64
+
+// Number of principal variations to search (UCI "MultiPV", helper threads keep 1)
+engine_local int multi_pv = 1;
+
+// Root moves skipped by the current MultiPV pass & their number
+engine_local int excluded_moves[max_multi_pv];
+engine_local int excluded_count;
+
+// Principal variation of a MultiPV line
+typedef struct {
+    int score;
+    int length;
+    int moves[max_ply];
+} pv_line;
+
+// Lines of the last MultiPV iteration, best first
+engine_local pv_line pv_lines[max_multi_pv];
+engine_local int pv_line_count;
+
+// Principal variation search & aspiration window toggles
+int use_pvs = 1;
+int use_aspiration = 1;
+
+// Initial aspiration window half width, full window beyond the last one
+#define aspiration_window 50
+#define aspiration_max_window 800
+
+// Selective search toggles
+int use_null_move = 1;
+int use_lmr = 1;
+int use_futility = 1;
+int use_reverse_futility = 1;
+
+// Null move depth reduction
+#define null_move_reduction 2
+
+// Late move reductions start after this many full depth moves & from this depth
+#define full_depth_moves 4
+#define reduction_limit 3
+
+// History score sparing a late move one ply of reduction
+#define lmr_history_limit 1000
+
+// History scores stay below killer move scores
+#define history_max 7000
+
+// Futility margins by remaining depth
+const int futility_margins[4] = { 0, 200, 300, 500 };
+
+// Reverse futility margin per remaining depth
+#define reverse_futility_margin 120
+
+// Read hash entry data (also hands back stored best move for move ordering)
+static inline int read_hash_entry(int alpha, int beta, int *move, int depth) {
+    // Create a TT instance pointer to particular hash entry storing the scoring data
+    tt *hash_entry = &hash_table[hash_key % hash_entries];
+    count_stat(tt_probes);
+
+    // Make sure we're dealing with the exact position we need
+    if (hash_entry->hash_key == hash_key) {
+        count_stat(tt_hits);
+
+        // Store best move
+        *move = hash_entry->best_move;
+
+        // Make sure that we match the exact depth our search is now at
+        if (hash_entry->depth >= depth) {
+            // Extract stored score from TT entry
+            int score = hash_entry->score;
+
+            // Retrieve score independent from the actual path from root node to current node
+            if (score < -mate_score) score += ply;
+            if (score > mate_score) score -= ply;
+
+            // Match the exact (PV node) score
+            if (hash_entry->flag == hash_flag_exact) return score;
+
+            // Match alpha (fail-low node) score
+            if ((hash_entry->flag == hash_flag_alpha) && (score <= alpha)) return alpha;
+
+            // Match beta (fail-high node) score
+            if ((hash_entry->flag == hash_flag_beta) && (score >= beta)) return beta;
+        }
+    }
+
+    // If hash entry doesn't exist
+    return no_hash_entry;
+}
+
+// Write hash entry data
+static inline void write_hash_entry(int score, int move, int depth, int hash_flag) {
+    // Create a TT instance pointer to particular hash entry storing the scoring data
+    tt *hash_entry = &hash_table[hash_key % hash_entries];
+
+    // Store score independent from the actual path from root node to current node
+    if (score < -mate_score) score -= ply;
+    if (score > mate_score) score += ply;
+
+    // Write hash entry data
+    hash_entry->hash_key = hash_key;
+    hash_entry->score = score;
+    hash_entry->flag = hash_flag;
+    hash_entry->depth = depth;
+    hash_entry->best_move = move;
+}
+
+// Score move for move ordering (hash move, then captures by MVV LVA)
+static inline int score_move(int move, int hash_move) {
+    // Hash move goes first
+    if (move == hash_move) return 20000;
+
+    // Score captures: most valuable victim, least valuable attacker
+    if (get_move_capture(move)) {
+        // Enpassant captures a pawn
+        int target_piece = P;
+
+        // Pick up opponent bitboard index range
+        int start_piece = (side == white) ? p : P;
+        int end_piece = (side == white) ? k : K;
+
+        // Loop over opponent bitboards
+        for (int bb_piece = start_piece; bb_piece <= end_piece; bb_piece++) {
+            if (get_bit(bitboards[bb_piece], get_move_target(move))) {
+                target_piece = bb_piece;
+                break;
+            }
+        }
+
+        return 10000 + (target_piece % 6 + 1) * 100 + 5 - get_move_piece(move) % 6;
+    }
+
+    // Killer moves right after captures
+    if (killer_moves[0][ply] == move) return 9000;
+    if (killer_moves[1][ply] == move) return 8000;
+
+    // Other quiet moves by history
+    return history_moves[get_move_piece(move)][get_move_target(move)];
+}
+
+// Reward quiet move causing beta cutoff (deeper cutoffs weigh more, scores age by halving)
+static inline void update_history(int move, int depth) {
+    // Shift killer moves
+    if (killer_moves[0][ply] != move) {
+        killer_moves[1][ply] = killer_moves[0][ply];
+        killer_moves[0][ply] = move;
+    }
+
+    // Bump history score
+    int *history = &history_moves[get_move_piece(move)][get_move_target(move)];
+    *history += depth * depth;
+
+    // Halve all scores once one gets too big
+    if (*history > history_max)
+        for (int piece = P; piece <= k; piece++)
+            for (int square = 0; square < 64; square++)
+                history_moves[piece][square] /= 2;
+}
+
+// Reset move ordering heuristics before a new search
+void clear_move_ordering() {
+    memset(killer_moves, 0, sizeof(killer_moves));
+    memset(history_moves, 0, sizeof(history_moves));
+}
+
+// Sort moves in descending order of their scores
+static inline void sort_moves(moves *move_list, int hash_move) {
+    // Move scores
+    int move_scores[256];
+
+    // Score all the moves within a move list
+    for (int count = 0; count < move_list->count; count++)
+        move_scores[count] = score_move(move_list->moves[count], hash_move);
+
+    // Loop over current move within a move list
+    for (int current_move = 0; current_move < move_list->count; current_move++) {
+        // Loop over next move within a move list
+        for (int next_move = current_move + 1; next_move < move_list->count; next_move++) {
+            // Compare current and next move scores
+            if (move_scores[current_move] < move_scores[next_move]) {
+                // Swap scores
+                int temp_score = move_scores[current_move];
+                move_scores[current_move] = move_scores[next_move];
+                move_scores[next_move] = temp_score;
+
+                // Swap moves
+                int temp_move = move_list->moves[current_move];
+                move_list->moves[current_move] = move_list->moves[next_move];
+                move_list->moves[next_move] = temp_move;
+            }
+        }
+    }
+}
+
+// Check if current position occurred before since the last irreversible move
+static inline int is_repetition() {
+    // Only positions with the same side to move can repeat, history starts at the last irreversible move
+    for (int index = repetition_index - 2; index >= 0; index -= 2)
+        if (repetition_table[index] == hash_key) return 1;
+
+    return 0;
+}
+
+// Stop search once time is up or node limit is reached (checked every 2048 nodes)
+static inline void check_time() {
+    if ((time_set && get_time_ms() - stop_time > 0) || (node_limit && nodes >= node_limit) ||
+        __atomic_load_n(&search_abort, __ATOMIC_RELAXED))
+        stopped = 1;
+}
+
+// Quiescence search
+static inline int quiescence(int alpha, int beta) {
+    // Increment nodes count
+    nodes++;
+    count_stat(qnodes);
+
+    // Check time control
+    if ((nodes & 2047) == 0) check_time();
+
+    // We are too deep, hence there's an overflow of arrays relying on max ply constant
+    if (ply > max_ply - 1) return evaluate();
+
+    // Evaluate position
+    int evaluation = evaluate();
+
+    // Fail-hard beta cutoff
+    if (evaluation >= beta) return beta;
+
+    // Found a better move
+    if (evaluation > alpha) alpha = evaluation;
+
+    // Create move list instance
+    moves move_list[1];
+
+    // Generate moves
+    generate_moves(move_list);
+
+    // Sort moves
+    sort_moves(move_list, 0);
+
+    // Loop over moves within a movelist
+    for (int count = 0; count < move_list->count; count++) {
+        // Preserve board state
+        copy_board();
+
+        // Increment ply
+        ply++;
+
+        // Make sure to make only legal captures
+        if (make_move(move_list->moves[count], only_captures) == 0) {
+            ply--;
+            continue;
+        }
+
+        // Score current move
+        int score = -quiescence(-beta, -alpha);
+
+        // Decrement ply & take move back
+        ply--;
+        take_back();
+
+        // Search was stopped, score is meaningless
+        if (stopped) return 0;
+
+        // Found a better move
+        if (score > alpha) {
+            alpha = score;
+
+            // Fail-hard beta cutoff
+            if (score >= beta) return beta;
+        }
+    }
+
+    // Node (move) fails low
+    return alpha;
+}
+
+// Check whether root move is excluded from the current MultiPV pass
+static inline int is_excluded_move(int move) {
+    for (int index = 0; index < excluded_count; index++)
+        if (excluded_moves[index] == move) return 1;
+
+    return 0;
+}
+
+// Negamax alpha beta search
+static inline int negamax(int alpha, int beta, int depth) {
+    // Init score & hash move
+    int score, hash_move = 0;
+
+    // Define hash flag
+    int hash_flag = hash_flag_alpha;
+
+    // Init PV length
+    if (ply < max_ply) pv_length[ply] = ply;
+
+    // Remember root material, bitbase wins only cut once it changed
+    if (!ply) root_material = material_key();
+
+    // PV node has open window
+    int pv_node = beta - alpha > 1;
+
+    // Repeated position or fifty move rule is a draw (root still has to pick a move)
+    if (ply && (fifty >= 100 || is_repetition())) return 0;
+
+    // Read hash entry, only cut off below the root (PV nodes keep searching to collect the PV)
+    if ((score = read_hash_entry(alpha, beta, &hash_move, depth)) != no_hash_entry && ply && !pv_node) {
+        count_stat(tt_cutoffs);
+        return score;
+    }
+
+    // Root searches the best move so far first (previous iteration or failed aspiration window)
+    if (!ply && !hash_move) hash_move = best_move;
+
+    // Tablebase result cuts the whole subtree, wins closer to the root score higher
+    // (private tables ignore en passant & the fifty move rule, see Tablebases)
+    int wdl;
+    if (ply && tb_can_probe() && tb_probe(tb_wdl, &wdl)) return wdl * (tb_win_score - ply);
+
+    // Known endgame cuts the whole subtree: draws always, wins once a capture or promotion reached the
+    // endgame (wins closer to the root score higher), within the root's own endgame the search has to find the mate
+    if (ply && use_bitbases && probe_bitbase(&score) && (!score || material_key() != root_material))
+        return score > 0 ? score - ply : score < 0 ? score + ply : 0;
+
+    // Recursion escape condition
+    if (depth <= 0) return quiescence(alpha, beta);
+
+    // We are too deep, hence there's an overflow of arrays relying on max ply constant
+    if (ply > max_ply - 1) return evaluate();
+
+    // Increment nodes count
+    nodes++;
+
+    // Check time control
+    if ((nodes & 2047) == 0) check_time();
+
+    // Is king in check
+    int in_check = is_square_attacked((side == white) ? get_ls1b_index(bitboards[K]) :
+                                                        get_ls1b_index(bitboards[k]), side ^ 1);
+
+    // Increase search depth if the king has been exposed into a check
+    if (in_check) depth++;
+
+    // Static evaluation for pruning decisions near the leaves
+    int static_eval = (ply && !in_check && (use_null_move || use_futility || use_reverse_futility)) ? evaluate() : 0;
+
+    // Reverse futility pruning: static evaluation beats beta by a margin per remaining depth
+    if (use_reverse_futility && ply && !pv_node && !in_check && depth <= 3 && abs(beta) < mate_score &&
+        static_eval - reverse_futility_margin * depth >= beta)
+        return beta;
+
+    // Null move pruning: passing still fails high (not without pieces, zugzwang is likely there)
+    if (use_null_move && ply && !pv_node && !in_check && depth >= 3 && static_eval >= beta &&
+        (side == white ? bitboards[N] | bitboards[B] | bitboards[R] | bitboards[Q] :
+                         bitboards[n] | bitboards[b] | bitboards[r] | bitboards[q])) {
+        // Preserve board state
+        copy_board();
+
+        // Increment ply
+        ply++;
+
+        // Hash out enpassant square
+        if (enpassant != no_sq) hash_key ^= enpassant_keys[enpassant];
+        enpassant = no_sq;
+
+        // Null move is irreversible, no repetitions across it
+        repetition_index = 0;
+
+        // Give the move to the opponent
+        side ^= 1;
+        hash_key ^= side_key;
+
+        // Search reduced depth with null window around beta
+        score = -negamax(-beta, -beta + 1, depth - 1 - null_move_reduction);
+
+        // Decrement ply & restore board state
+        ply--;
+        take_back();
+
+        // Search was stopped, score is meaningless
+        if (stopped) return 0;
+
+        // Fail-hard beta cutoff
+        if (score >= beta) return beta;
+    }
+
+    // Futility pruning: quiet moves can't lift hopeless score above alpha
+    int futile = use_futility && ply && !in_check && depth <= 3 && abs(alpha) < mate_score &&
+                 static_eval + futility_margins[depth] <= alpha;
+
+    // Legal moves counter
+    int legal_moves = 0;
+
+    // Moves searched (pruned moves are legal but not searched)
+    int moves_searched = 0;
+
+    // Best move in this node
+    int node_best_move = 0;
+
+    // Create move list instance
+    moves move_list[1];
+
+    // Generate moves
+    generate_moves(move_list);
+
+    // Sort moves
+    sort_moves(move_list, hash_move);
+
+    // Loop over moves within a movelist
+    for (int count = 0; count < move_list->count; count++) {
+        // Skip root moves of lines found by earlier MultiPV passes
+        if (!ply && excluded_count && is_excluded_move(move_list->moves[count])) continue;
+
+        // Preserve board state
+        copy_board();
+
+        // Increment ply
+        ply++;
+
+        // Make sure to make only legal moves
+        if (make_move(move_list->moves[count], all_moves) == 0) {
+            ply--;
+            continue;
+        }
+
+        // Increment legal moves
+        legal_moves++;
+
+        // Init move
+        int move = move_list->moves[count];
+
+        // Quiet moves not giving check may be pruned or reduced
+        int quiet = !get_move_capture(move) && !get_move_promoted(move);
+        int prunable = quiet && !in_check &&
+                       !is_square_attacked(get_ls1b_index(bitboards[side == white ? K : k]), side ^ 1);
+
+        // Skip futile quiet moves once a move has been searched
+        if (futile && prunable && moves_searched) {
+            ply--;
+            take_back();
+            continue;
+        }
+
+        // Search first move with full depth & window
+        if (moves_searched == 0)
+            score = -negamax(-beta, -alpha, depth - 1);
+
+        else {
+            // Late move reductions: late quiet moves get reduced null window search first
+            int reduced = use_lmr && prunable && moves_searched >= full_depth_moves && depth >= reduction_limit &&
+                          move != killer_moves[0][ply - 1] && move != killer_moves[1][ply - 1];
+
+            if (reduced) {
+                // Reduce more later in the list, less for moves with good history
+                int reduction = 1 + (moves_searched >= 2 * full_depth_moves) -
+                                (history_moves[get_move_piece(move)][get_move_target(move)] >= lmr_history_limit);
+
+                score = -negamax(-alpha - 1, -alpha, depth - 1 - reduction);
+            }
+
+            // Otherwise make sure full depth search is done
+            else score = alpha + 1;
+
+            // Full depth search
+            if (score > alpha) {
+                if (reduced) count_stat(lmr_researches);
+
+                // PVS: prove the move is no better than alpha with a null window scout
+                if (use_pvs) {
+                    count_stat(pvs_scouts);
+                    score = -negamax(-alpha - 1, -alpha, depth - 1);
+
+                    // Scout failed high inside the window, re-search with full window
+                    if (score > alpha && score < beta) {
+                        count_stat(pvs_researches);
+                        score = -negamax(-beta, -alpha, depth - 1);
+                    }
+                }
+
+                else score = -negamax(-beta, -alpha, depth - 1);
+            }
+        }
+
+        // Increment searched moves
+        moves_searched++;
+
+        // Decrement ply & take move back
+        ply--;
+        take_back();
+
+        // Search was stopped, score is meaningless
+        if (stopped) return 0;
+
+        // Found a better move
+        if (score > alpha) {
+            // Switch hash flag from storing score for fail-low node to the one storing score for PV node
+            hash_flag = hash_flag_exact;
+
+            // Store best move
+            node_best_move = move_list->moves[count];
+            if (!ply) best_move = node_best_move;
+
+            // Write PV move & copy PV from deeper ply (the last ply has no deeper PV)
+            pv_table[ply][ply] = node_best_move;
+
+            if (ply + 1 < max_ply) {
+                for (int next_ply = ply + 1; next_ply < pv_length[ply + 1]; next_ply++)
+                    pv_table[ply][next_ply] = pv_table[ply + 1][next_ply];
+
+                pv_length[ply] = pv_length[ply + 1];
+            }
+            else pv_length[ply] = ply + 1;
+
+            // PV node (move)
+            alpha = score;
+
+            // Fail-hard beta cutoff
+            if (score >= beta) {
+                // Count cutoffs & how often the first move causes them
+                count_stat(beta_cutoffs);
+                if (moves_searched == 1) count_stat(first_move_cutoffs);
+
+                // Remember quiet move causing the cutoff
+                if (quiet) update_history(move, depth);
+
+                // Store hash entry with the score equal to beta (root entry is only right for the best line)
+                if (ply || !excluded_count) write_hash_entry(beta, node_best_move, depth, hash_flag_beta);
+
+                // Node (move) fails high
+                return beta;
+            }
+        }
+    }
+
+    // We don't have any legal moves to make in the current position
+    if (legal_moves == 0) {
+        // King is in check: return mating score (closest distance to mating position)
+        if (in_check) return -mate_value + ply;
+
+        // King is not in check: return stalemate score
+        return 0;
+    }
+
+    // Store hash entry with the score equal to alpha (root entry is only right for the best line)
+    if (ply || !excluded_count) write_hash_entry(alpha, node_best_move, depth, hash_flag);
+
+    // Node (move) fails low
+    return alpha;
+}
+
+// Write search score in UCI format into string (at least 24 bytes)
+void write_score(char *string, int score) {
+    if (score > -mate_value && score < -mate_score)
+        sprintf(string, "score mate %d", -(score + mate_value) / 2 - 1);
+    else if (score > mate_score && score < mate_value)
+        sprintf(string, "score mate %d", (mate_value - score) / 2 + 1);
+    else
+        sprintf(string, "score cp %d", score);
+}
+
+// Print search score in UCI format
+void print_score(int score) {
+    char string[24];
+    write_score(string, score);
+    printf("%s", string);
+}
+
+// Search one iteration in aspiration window around previous score, widening on failures
+int search_iteration(int depth, int previous_score) {
+    // Full window for the first iteration & without aspiration
+    if (!use_aspiration || depth == 1) return negamax(-infinity, infinity, depth);
+
+    // Init window around previous score
+    int window = aspiration_window;
+    int alpha = previous_score - window, beta = previous_score + window;
+
+    while (1) {
+        count_stat(aspiration_searches);
+        int score = negamax(alpha, beta, depth);
+
+        // Search was stopped, caller drops the iteration
+        if (stopped) return score;
+
+        // Widen failed bound, give up on window once it gets too wide
+        window *= 2;
+
+        if (score <= alpha) {
+            count_stat(aspiration_fail_lows);
+            alpha = (window > aspiration_max_window) ? -infinity : score - window;
+        }
+
+        else if (score >= beta) {
+            count_stat(aspiration_fail_highs);
+            beta = (window > aspiration_max_window) ? infinity : score + window;
+        }
+
+        else return score;
+    }
+}
+
+// Print principal variation of the last iteration
+void print_pv() {
+    // Fall back to root best move without PV
+    if (!pv_length[0]) print_move(best_move);
+
+    for (int count = 0; count < pv_length[0]; count++) {
+        print_move(pv_table[0][count]);
+        printf(count + 1 < pv_length[0] ? " " : "");
+    }
+}
+
+// Count legal moves in current position
+int count_legal_moves() {
+    moves move_list[1];
+    generate_moves(move_list);
+
+    int legal_moves = 0;
+
+    for (int count = 0; count < move_list->count; count++) {
+        copy_board();
+        legal_moves += make_move(move_list->moves[count], all_moves);
+        take_back();
+    }
+
+    return legal_moves;
+}
+
+/*
+    MultiPV: every iteration searches the root in passes, each pass skips
+    the root moves of the lines found by the passes before it, so pass K
+    finds the K-th best move & its line. Passes share the hash table &
+    move ordering, the subtrees searched by the first pass make the later
+    ones cheap. Only the root hash entry is left alone as it's right for the
+    best line only.
+*/
+
+// Search one iteration of every MultiPV line (returns best score, sets best_move & pv_lines)
+int search_multi_pv(int depth, int previous_score) {
+    // Single line is a plain iteration
+    if (multi_pv <= 1) return search_iteration(depth, previous_score);
+
+    // Never more lines than legal root moves (mated or stalemated root is a plain iteration too)
+    int lines = count_legal_moves();
+    if (!lines) return search_iteration(depth, previous_score);
+    if (lines > multi_pv) lines = multi_pv;
+
+    // Lines of the previous iteration guide aspiration windows
+    int previous_count = pv_line_count;
+    pv_line_count = 0;
+
+    for (int line = 0; line < lines; line++) {
+        excluded_count = line;
+        int score = search_iteration(depth, line < previous_count ? pv_lines[line].score : previous_score);
+
+        // Search was stopped, caller drops the iteration
+        if (stopped) break;
+
+        // Keep line & skip its root move in the next passes
+        pv_lines[line].score = score;
+        pv_lines[line].length = pv_length[0] ? pv_length[0] : 1;
+        memcpy(pv_lines[line].moves, pv_length[0] ? pv_table[0] : &best_move, pv_lines[line].length * sizeof(int));
+
+        excluded_moves[line] = pv_lines[line].moves[0];
+        pv_line_count++;
+    }
+
+    excluded_count = 0;
+
+    if (stopped) return 0;
+
+    // Sort lines best first (later passes may return a higher score when the search is unstable)
+    for (int line = 1; line < pv_line_count; line++) {
+        pv_line current = pv_lines[line];
+        int index = line;
+
+        for (; index && pv_lines[index - 1].score < current.score; index--) pv_lines[index] = pv_lines[index - 1];
+        pv_lines[index] = current;
+    }
+
+    // Best line gives best move
+    best_move = pv_lines[0].moves[0];
+    return pv_lines[0].score;
+}
+
+// Iterative deepening from fresh search state (returns depth of the last complete iteration, sets best_move)
+int iterative_deepening(int depth, int *score, int print_info) {
+    // Reset search state
+    nodes = 0;
+    ply = 0;
+    best_move = 0;
+    stopped = 0;
+    *score = 0;
+    long tb_hits_start = tb_hits[tb_wdl];
+    reset_stats();
+    clear_move_ordering();
+    memset(pv_length, 0, sizeof(pv_length));
+    pv_line_count = 0;
+
+    // Init start time
+    int start = get_time_ms(), completed_depth = 0;
+
+    // Iterative deepening
+    for (int current_depth = 1; current_depth <= depth; current_depth++) {
+        // Keep best move of the last complete iteration
+        int last_best_move = best_move;
+
+        // Find best move (or best moves) within a given position
+        int iteration_score = search_multi_pv(current_depth, *score);
+
+        // Time is up, fall back to the last complete iteration
+        if (stopped) {
+            if (last_best_move) best_move = last_best_move;
+            break;
+        }
+
+        *score = iteration_score;
+        completed_depth = current_depth;
+
+        // Print search info of every MultiPV line
+        if (print_info && multi_pv > 1) {
+            for (int line = 0; line < pv_line_count; line++) {
+                printf("info depth %d multipv %d ", current_depth, line + 1);
+                print_score(pv_lines[line].score);
+                printf(" nodes %ld tbhits %ld time %d pv", nodes, tb_hits[tb_wdl] - tb_hits_start,
+                       get_time_ms() - start);
+
+                for (int count = 0; count < pv_lines[line].length; count++) {
+                    printf(" ");
+                    print_move(pv_lines[line].moves[count]);
+                }
+
+                printf("\n");
+            }
+        }
+
+        // Print search info
+        else if (print_info) {
+            printf("info ");
+            print_score(*score);
+            printf(" depth %d nodes %ld tbhits %ld time %d pv ", current_depth, nodes,
+                   tb_hits[tb_wdl] - tb_hits_start, get_time_ms() - start);
+            print_pv();
+            printf("\n");
+        }
+
+        // Record iteration counters
+        record_iteration(current_depth, *score, get_time_ms() - start);
+
+        // Next iteration would most likely not finish in time
+        if (time_set && get_time_ms() - soft_time > 0) break;
+    }
+
+    return completed_depth;
+}
+
+/*
+    Lazy SMP: helper threads run the same iterative deepening on copies of
+    the root position, sharing only the hash table (entries are written
+    without locks, a torn entry costs a wrong bound at worst since hash moves
+    are only used when they match a generated move). The main thread reports
+    & picks the move, helpers stop when it's done.
+*/
+
+// Max search threads
+#define max_threads 256
+
+// Helper thread stack size (holds thread local state, reserved lazily)
+#define thread_stack_size (8 * 1024 * 1024)
+
+// Number of search threads (UCI "Threads")
+int thread_count = 1;
+
+#ifndef WIN64
+
+// Helper search thread
+typedef struct {
+    pthread_t thread;
+    int index;
+    int depth;
+
+    // Root position & shared hash table
+    board_state board;
+    tt *hash_table;
+    int hash_entries;
+
+    // Stack placed on thread's node
+    void *stack;
+
+    // Totals published after every iteration
+    thread_totals *totals;
+
+    // Nodes & counters searched by the helper
+    long nodes;
+    search_stats stats;
+} search_thread;
+
+// Helper thread: search until main thread is done
+void *helper_search(void *argument) {
+    search_thread *helper = argument;
+    if (use_numa_pinning) pin_thread(helper->index);
+
+    // Init position & shared hash table
+    load_board(&helper->board);
+    hash_table = helper->hash_table;
+    hash_entries = helper->hash_entries;
+    time_set = 0;
+    node_limit = 0;
+    published_totals = helper->totals;
+
+    int score;
+    iterative_deepening(helper->depth, &score, 0);
+
+    helper->nodes = nodes;
+    helper->stats = stats;
+    return NULL;
+}
+
+// Start helper with its stack preferring its node (returns 0 on failure)
+int start_helper(search_thread *helper) {
+    helper->nodes = 0;
+    helper->stack = NULL;
+
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+
+    // Thread local state sits in the thread's stack, place it on thread's node
+    if (use_numa_pinning && numa_node_count > 1) {
+        helper->stack = mmap(NULL, thread_stack_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK,
+                             -1, 0);
+
+        if (helper->stack == MAP_FAILED) helper->stack = NULL;
+
+        else {
+            bind_memory(helper->stack, thread_stack_size, mpol_preferred,
+                        1UL << numa_node_ids[thread_node(helper->index)]);
+            pthread_attr_setstack(&attributes, helper->stack, thread_stack_size);
+        }
+    }
+
+    int started = !pthread_create(&helper->thread, &attributes, helper_search, helper);
+    pthread_attr_destroy(&attributes);
+
+    if (!started && helper->stack) munmap(helper->stack, thread_stack_size);
+
+    return started;
+}
+
+#endif
+
+// Search with all threads (returns depth of the last complete iteration, nodes of all threads in nodes)
+int parallel_search(int depth, int *score, int print_info) {
+    #ifdef WIN64
+        return iterative_deepening(depth, score, print_info);
+    #else
+        // Single thread stays unpinned, so parallel engine processes spread freely
+        if (thread_count < 2) {
+            unpin_thread();
+            return iterative_deepening(depth, score, print_info);
+        }
+
+        // Main thread is search thread 0
+        if (use_numa_pinning) pin_thread(0);
+        else unpin_thread();
+
+        // Start helpers, main thread iterations add their published totals
+        search_thread *helpers = malloc((thread_count - 1) * sizeof(search_thread));
+        thread_totals totals[max_threads] = { 0 };
+        int started[max_threads] = { 0 };
+        __atomic_store_n(&search_abort, 0, __ATOMIC_RELAXED);
+        helper_totals = totals;
+        helper_totals_count = thread_count - 1;
+
+        for (int index = 0; index < thread_count - 1; index++) {
+            helpers[index].index = index + 1;
+            helpers[index].totals = &totals[index];
+            helpers[index].depth = depth;
+            helpers[index].hash_table = hash_table;
+            helpers[index].hash_entries = hash_entries;
+            save_board(&helpers[index].board);
+            started[index] = start_helper(&helpers[index]);
+        }
+
+        // Main search
+        int completed_depth = iterative_deepening(depth, score, print_info);
+
+        // Stop helpers & collect their nodes & counters
+        __atomic_store_n(&search_abort, 1, __ATOMIC_RELAXED);
+
+        for (int index = 0; index < thread_count - 1; index++) {
+            if (!started[index]) continue;
+
+            pthread_join(helpers[index].thread, NULL);
+            if (helpers[index].stack) munmap(helpers[index].stack, thread_stack_size);
+
+            nodes += helpers[index].nodes;
+            merge_stats(&stats, &helpers[index].stats);
+        }
+
+        // Last iteration record covers the final totals of all threads
+        if (iteration_count) {
+            iterations[iteration_count - 1].nodes = nodes;
+            iterations[iteration_count - 1].stats = stats;
+        }
+
+        helper_totals = NULL;
+        helper_totals_count = 0;
+        __atomic_store_n(&search_abort, 0, __ATOMIC_RELAXED);
+        free(helpers);
+
+        return completed_depth;
+    #endif
+}
+
+// Search position for the best move
+void search_position(int depth) {
+    // Play book move if position is still in book
+    int move = book_move(book_weighted);
+
+    if (move) {
+        printf("bestmove ");
+        print_move(move);
+        printf("\n");
+        return;
+    }
+
+    // Play the move keeping tablebase result with the best DTZ
+    int score;
+    long tb_hits_start = tb_hits[tb_wdl] + tb_hits[tb_dtz];
+
+    if ((move = tb_root_move(&score))) {
+        printf("info depth 0 score cp %d tbhits %ld pv ", score, tb_hits[tb_wdl] + tb_hits[tb_dtz] - tb_hits_start);
+        print_move(move);
+        printf("\nbestmove ");
+        print_move(move);
+        printf("\n");
+        return;
+    }
+
+    // Search
+    parallel_search(depth, &score, 1);
+
+    // Print search record
+    print_telemetry(best_move);
+
+    // Print best move
+    printf("bestmove ");
+    print_move(best_move);
+    printf("\n");
+}
+
+// Endgame positions used to measure bitbase node savings
+const char *bitbase_positions[] = {
+    "8/8/8/4k3/8/8/4P3/4K3 w - - 0 1",
+    "4k3/8/4K3/4P3/8/8/8/8 b - - 0 1",
+    "8/8/1k6/8/8/8/P7/K7 w - - 0 1",
+    "8/8/8/4k3/8/8/8/R3K3 w - - 0 1",
+    "8/8/8/2k5/8/8/8/3QK3 w - - 0 1",
+    "8/8/8/4k3/8/2n5/4P3/4K3 w - - 0 1",
+    "8/5k2/8/4PK2/8/8/8/6r1 w - - 0 1",
+    "8/8/8/8/3k4/8/3KP3/7q b - - 0 1",
+};
+
+// Search endgame positions with bitbases on & off
+int bench_bitbase(int depth) {
+    // Time bitbase generation
+    int start = get_time_ms();
+    init_bitbases();
+    printf("\n     Generation:  %d ms (%d KB)\n\n", get_time_ms() - start,
+           (int)(sizeof(kqk_bitbase) + sizeof(krk_bitbase) + sizeof(kpk_bitbase)) / 1024);
+
+    // Total node counts with & without bitbases
+    long total_nodes[2] = {0, 0};
+    int total_time[2] = {0, 0};
+
+    // Loop over positions
+    for (int index = 0; index < (int)(sizeof(bitbase_positions) / sizeof(bitbase_positions[0])); index++) {
+        printf("     %-40s", bitbase_positions[index]);
+
+        // Skip broken positions
+        int error = parse_fen(bitbase_positions[index]);
+
+        if (error != fen_ok) {
+            printf("  %s\n", fen_errors[error]);
+            continue;
+        }
+
+        // Search with bitbases off, then on
+        for (int mode = 0; mode < 2; mode++) {
+            use_bitbases = mode;
+            parse_fen(bitbase_positions[index]);
+            clear_hash_table();
+
+            // Init search state
+            nodes = 0;
+            ply = 0;
+            best_move = 0;
+            int score = 0;
+            start = get_time_ms();
+
+            // Iterative deepening
+            for (int current_depth = 1; current_depth <= depth; current_depth++)
+                score = negamax(-infinity, infinity, current_depth);
+
+            total_nodes[mode] += nodes;
+            total_time[mode] += get_time_ms() - start;
+
+            printf("  %s %9ld nodes %6d cp", mode ? "on:" : "off:", nodes, score);
+        }
+
+        printf("\n");
+    }
+
+    // Print totals
+    printf("\n     Nodes off:   %ld (%d ms)\n", total_nodes[0], total_time[0]);
+    printf("     Nodes on:    %ld (%d ms)\n", total_nodes[1], total_time[1]);
+    printf("     Reduction:   %.1f%%\n\n", total_nodes[0] ? 100.0 - 100.0 * total_nodes[1] / total_nodes[0] : 0.0);
+
+    use_bitbases = 1;
+    return 0;
+}
+
+// Built-in positions used to measure search
+const char *search_positions[] = { start_position, tricky_position, killer_position, cmk_position };
+
+// Search position to fixed depth from fresh search state (returns nodes, sets last iteration EBF)
+long search_fixed_depth(const char *fen, int depth, double *ebf) {
+    // Init position, skip positions the FEN parser rejects
+    *ebf = 0.0;
+    if (parse_fen(fen) != fen_ok) return 0;
+
+    // Init fresh search state
+    clear_hash_table();
+    clear_move_ordering();
+    nodes = 0;
+    ply = 0;
+    time_set = 0;
+    stopped = 0;
+    pv_line_count = 0;
+
+    // Iterative deepening, keep node counts of the last two iterations
+    long previous_nodes = 0, iteration_nodes = 0;
+    int score = 0;
+
+    for (int current_depth = 1; current_depth <= depth; current_depth++) {
+        long nodes_before = nodes;
+        score = search_multi_pv(current_depth, score);
+
+        previous_nodes = iteration_nodes;
+        iteration_nodes = nodes - nodes_before;
+    }
+
+    *ebf = previous_nodes ? (double)iteration_nodes / previous_nodes : 0.0;
+    return nodes;
+}
+
+// Search built-in positions to fixed depth (returns total nodes, adds time to depth & last iteration EBF)
+long search_bench_positions(int depth, int *time, double *ebf) {
+    long total_nodes = 0;
+
+    for (int index = 0; index < (int)(sizeof(search_positions) / sizeof(search_positions[0])); index++) {
+        double position_ebf;
+        int start = get_time_ms();
+
+        total_nodes += search_fixed_depth(search_positions[index], depth, &position_ebf);
+
+        *time += get_time_ms() - start;
+        *ebf += position_ebf;
+    }
+
+    return total_nodes;
+}
+
+// Measure each selective search technique alone & all together on built-in positions
+int bench_search(int depth) {
+    // Technique toggles per configuration: null move, LMR, reverse futility, futility
+    const char *names[] = { "baseline", "null move", "late move reductions", "reverse futility", "futility", "all" };
+    const int toggles[][4] = { {0, 0, 0, 0}, {1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}, {1, 1, 1, 1} };
+    int positions = sizeof(search_positions) / sizeof(search_positions[0]);
+
+    printf("\n     %d built-in positions, depth %d\n\n", positions, depth);
+    printf("     %-22s %12s %10s %8s %8s\n", "Configuration", "Nodes", "Time", "EBF", "Nodes %");
+
+    long baseline_nodes = 0;
+
+    for (int config = 0; config < 6; config++) {
+        // Set toggles
+        use_null_move = toggles[config][0];
+        use_lmr = toggles[config][1];
+        use_reverse_futility = toggles[config][2];
+        use_futility = toggles[config][3];
+
+        // Search positions
+        int time = 0;
+        double ebf = 0.0;
+        long total_nodes = search_bench_positions(depth, &time, &ebf);
+        if (!config) baseline_nodes = total_nodes;
+
+        printf("     %-22s %12ld %7d ms %8.2f %7.1f%%\n", names[config], total_nodes, time, ebf / positions,
+               100.0 * total_nodes / baseline_nodes);
+    }
+
+    // Restore defaults
+    use_null_move = use_lmr = use_reverse_futility = use_futility = 1;
+
+    printf("\n");
+    return 0;
+}
+
+// Compare full window search with PVS & aspiration windows at equal depth on built-in positions
+int bench_pvs(int depth) {
+    // Toggles per configuration: PVS, aspiration windows
+    const char *names[] = { "full window", "PVS", "aspiration", "PVS + aspiration" };
+    const int toggles[][2] = { {0, 0}, {1, 0}, {0, 1}, {1, 1} };
+    int positions = sizeof(search_positions) / sizeof(search_positions[0]);
+
+    printf("\n     %d built-in positions, depth %d\n\n", positions, depth);
+    printf("     %-18s %12s %10s %8s %18s %18s\n", "Configuration", "Nodes", "Time", "Nodes %",
+           "PVS re-searches", "Window re-searches");
+
+    long full_window_nodes = 0;
+
+    for (int config = 0; config < 4; config++) {
+        use_pvs = toggles[config][0];
+        use_aspiration = toggles[config][1];
+
+        // Search positions
+        int time = 0;
+        double ebf = 0.0;
+        reset_stats();
+        long total_nodes = search_bench_positions(depth, &time, &ebf);
+        if (!config) full_window_nodes = total_nodes;
+
+        // Re-search frequencies: per scout & per aspiration search
+        char pvs_researches[32], window_researches[32];
+        snprintf(pvs_researches, sizeof(pvs_researches), "%ld (%.1f%%)", stats.pvs_researches,
+                 100.0 * ratio(stats.pvs_researches, stats.pvs_scouts));
+        snprintf(window_researches, sizeof(window_researches), "%ld (%.1f%%)",
+                 stats.aspiration_fail_lows + stats.aspiration_fail_highs,
+                 100.0 * ratio(stats.aspiration_fail_lows + stats.aspiration_fail_highs, stats.aspiration_searches));
+
+        printf("     %-18s %12ld %7d ms %7.1f%% %18s %18s\n", names[config], total_nodes, time,
+               100.0 * total_nodes / full_window_nodes, pvs_researches, window_researches);
+    }
+
+    // Restore defaults
+    use_pvs = use_aspiration = 1;
+
+    printf("\n");
+    return 0;
+}
+
+// Measure MultiPV cost for 1 to max_lines lines at equal depth on built-in positions
+int bench_multi_pv(int depth, int max_lines) {
+    int positions = sizeof(search_positions) / sizeof(search_positions[0]);
+    if (max_lines < 1) max_lines = 1;
+    if (max_lines > max_multi_pv) max_lines = max_multi_pv;
+
+    printf("\n     %d built-in positions, depth %d\n\n", positions, depth);
+    printf("     %-8s %12s %10s %12s %12s\n", "MultiPV", "Nodes", "Time", "Nodes x", "Per line x");
+
+    long single_nodes = 0;
+
+    for (int lines = 1; lines <= max_lines; lines++) {
+        multi_pv = lines;
+
+        // Search positions
+        int time = 0;
+        double ebf = 0.0;
+        long total_nodes = search_bench_positions(depth, &time, &ebf);
+        if (lines == 1) single_nodes = total_nodes;
+
+        printf("     %-8d %12ld %7d ms %11.2fx %11.2fx\n", lines, total_nodes, time,
+               (double)total_nodes / single_nodes, (double)total_nodes / single_nodes / lines);
+    }
+
+    // Restore default
+    multi_pv = 1;
+
+    printf("\n");
+    return 0;
+}
+
+// Positions searched by "bench": openings, middlegames & endgames
+const char *bench_positions[] = {
+    start_position,
+    tricky_position,
+    cmk_position,
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP2BPPP/R2QKB1R w KQ - 0 8",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "8/8/4k3/3p4/3P4/4K3/8/8 w - - 0 1"
+};
+
+// Default "bench" depth
+#define bench_depth 8
+
+/*
+    Deterministic search workload: every position is searched to the same
+    depth from a cleared hash table & move ordering, so the total node count
+    is a signature of search behaviour (it changes only when search or
+    evaluation does) while nodes per second measure the build. The same
+    workload trains profile guided optimization builds (see makefile).
+*/
+int bench(int depth) {
+    int positions = sizeof(bench_positions) / sizeof(bench_positions[0]);
+    long total_nodes = 0;
+    long long start = get_time_ns();
+
+    for (int index = 0; index < positions; index++) {
+        double ebf;
+        long position_nodes = search_fixed_depth(bench_positions[index], depth, &ebf);
+        total_nodes += position_nodes;
+
+        printf("     Position %2d: %10ld nodes\n", index + 1, position_nodes);
+    }
+
+    // Time in ms (at least 1 to keep NPS finite)
+    long long time = (get_time_ns() - start) / 1000000;
+    if (time < 1) time = 1;
+
+    printf("\n     Depth:         %d\n", depth);
+    printf("     Nodes:         %ld\n", total_nodes);
+    printf("     Time:          %lld ms\n", time);
+    printf("     NPS:           %lld\n\n", total_nodes * 1000 / time);
+
+    return 0;
+}
+
+// Measure Lazy SMP NPS scaling with NUMA pinning off & on on bench positions
+int bench_smp(int depth, int max_thread_count) {
+    int positions = sizeof(bench_positions) / sizeof(bench_positions[0]);
+
+    // Default to one thread per allowed CPU
+    if (max_thread_count < 1)
+        for (int node = 0; node < numa_node_count; node++) max_thread_count += numa_cpu_counts[node];
+
+    if (max_thread_count > max_threads) max_thread_count = max_threads;
+
+    // Print topology
+    printf("\n     %d NUMA node(s):", numa_node_count);
+    for (int node = 0; node < numa_node_count; node++)
+        printf(" node%d %d CPUs%s", numa_node_ids[node], numa_cpu_counts[node], node + 1 < numa_node_count ? "," : "");
+    printf("\n     %d bench positions, depth %d\n\n", positions, depth);
+
+    printf("     %-8s %-8s %12s %10s %12s %8s %10s\n", "Threads", "Pinning", "Nodes", "Time", "NPS", "Scaling",
+           "Speedup");
+
+    // Single thread NPS & time to depth per pinning mode
+    double base_nps[2] = { 0.0 };
+    long long base_time[2] = { 0 };
+
+    // Double threads up to max thread count
+    for (int threads = 1;; threads = threads * 2 < max_thread_count ? threads * 2 : max_thread_count) {
+        for (int pinning = 0; pinning < 2; pinning++) {
+            thread_count = threads;
+            use_numa_pinning = pinning;
+
+            // Time to depth on all positions
+            long total_nodes = 0;
+            long long start = get_time_ns();
+
+            for (int index = 0; index < positions; index++) {
+                if (parse_fen(bench_positions[index]) != fen_ok) continue;
+                clear_hash_table();
+                time_set = 0;
+
+                int score;
+                parallel_search(depth, &score, 0);
+                total_nodes += nodes;
+            }
+
+            long long time = (get_time_ns() - start) / 1000000;
+            if (time < 1) time = 1;
+
+            double nps = total_nodes * 1000.0 / time;
+
+            if (threads == 1) {
+                base_nps[pinning] = nps;
+                base_time[pinning] = time;
+            }
+
+            printf("     %-8d %-8s %12ld %7lld ms %12.0f %7.2fx %9.2fx\n", threads, pinning ? "on" : "off", total_nodes, time,
+                   nps, nps / base_nps[pinning], (double)base_time[pinning] / time);
+        }
+
+        if (threads >= max_thread_count) break;
+    }
+
+    // Restore defaults
+    thread_count = 1;
+    use_numa_pinning = 1;
+    unpin_thread();
+
+    printf("\n     Scaling is NPS over one thread, speedup is time to depth over one thread\n\n");
+    return 0;
+}
+
+// Endgame positions used to measure tablebase probing (need KRvK, KPvK & KQvKR tables)
+const char *tb_positions[] = {
+    "8/8/8/4k3/8/8/8/R3K3 w - - 0 1",
+    "8/8/8/4k3/8/8/4P3/4K3 w - - 0 1",
+    "4k3/8/4K3/4P3/8/8/8/8 b - - 0 1",
+    "8/8/2k5/8/8/8/1r6/3QK3 w - - 0 1",
+    "3qk3/8/8/8/8/8/1R6/4K3 b - - 0 1",
+    "8/8/8/8/8/2k5/1r6/3QK3 w - - 0 1",
+};
+
+// Search tablebase endgames with probing off & on, print root DTZ moves & probe statistics
+int bench_tb(const char *path, int depth) {
+    // Total node counts with & without tablebases
+    long total_nodes[2] = {0, 0};
+    int total_time[2] = {0, 0};
+
+    // Bitbases would hide tablebase cutoffs
+    use_bitbases = 0;
+    tb_reset_stats();
+    printf("\n");
+
+    for (int index = 0; index < (int)(sizeof(tb_positions) / sizeof(tb_positions[0])); index++) {
+        printf("     %-36s", tb_positions[index]);
+
+        // Skip broken positions
+        int error = parse_fen(tb_positions[index]);
+
+        if (error != fen_ok) {
+            printf("  %s\n", fen_errors[error]);
+            continue;
+        }
+
+        // Root move filtered by DTZ
+        snprintf(tb_path, sizeof(tb_path), "%s", path);
+        int score, move = tb_root_move(&score);
+
+        if (move) {
+            printf(" tb ");
+            print_move(move);
+            printf(" %6d cp", score);
+        }
+
+        else printf(" tb search       ");
+
+        // Search with tablebases off, then on
+        for (int mode = 0; mode < 2; mode++) {
+            snprintf(tb_path, sizeof(tb_path), "%s", mode ? path : "");
+            parse_fen(tb_positions[index]);
+            clear_hash_table();
+
+            // Init search state
+            nodes = 0;
+            ply = 0;
+            best_move = 0;
+            int start = get_time_ms();
+
+            // Iterative deepening
+            for (int current_depth = 1; current_depth <= depth; current_depth++)
+                score = negamax(-infinity, infinity, current_depth);
+
+            total_nodes[mode] += nodes;
+            total_time[mode] += get_time_ms() - start;
+
+            printf("  %s %9ld nodes %6d cp", mode ? "on:" : "off:", nodes, score);
+        }
+
+        printf("\n");
+    }
+
+    // Print totals & probe statistics
+    printf("\n     Nodes off:   %ld (%d ms)\n", total_nodes[0], total_time[0]);
+    printf("     Nodes on:    %ld (%d ms)\n", total_nodes[1], total_time[1]);
+    printf("     Reduction:   %.1f%%\n", total_nodes[0] ? 100.0 - 100.0 * total_nodes[1] / total_nodes[0] : 0.0);
+    tb_print_stats();
+
+    use_bitbases = 1;
+    return 0;
+}
+
+/* ======================================================================== */
+/* ========================= Proof-number search ========================== */
+/* ======================================================================== */
+
+/*
+    Depth-first proof-number search (df-pn) for forced mates. The attacker
+    only plays checks & the defender plays all of its legal moves, which
+    are evasions as it's always in check. A node is proven when the
+    defender is mated & disproven when the attacker runs out of checks or
+    moves. The proof number of a node is the number of leaves still to be
+    proven to prove it, the disproof number the same for disproving it.
+    Search always descends into the most proving child & backs up as soon
+    as the numbers cross the thresholds it was given, so only the numbers
+    are kept, in a hash table of their own keyed by position & attacker
+    moves left.
+
+    "mate N" looks for mates in 1, 2 ... N moves, the first proof found is
+    a shortest checking mate. A disproof means that there is no mate with
+    checks only within N moves, quiet first moves aren't tried. Under UCI
+    the search polls the GUI every 2048 nodes, so "isready", "stop" &
+    "quit" are answered while it runs, & gives up at its deadline.
+*/
+
+// Proof & disproof number bound (solved nodes)
+#define pn_infinite 100000000
+
+// Default proof-number hash size in MB & node limit
+#define pn_default_hash 64
+#define pn_default_nodes 20000000
+
+// Proof-number hash entry
+typedef struct {
+    U64 key;
+    int pn;
+    int dn;
+} pn_entry;
+
+// Proof-number hash table
+engine_local pn_entry *pn_table = NULL;
+engine_local int pn_entries = 0;
+
+// Proof-number search nodes & node limit
+engine_local long pn_nodes;
+engine_local long pn_node_limit = pn_default_nodes;
+
+// Poll GUI input while proving & deadline in ms (0 means none)
+engine_local int pn_poll_input;
+engine_local int pn_stop_time;
+
+// GUI asked to stop or quit during the mate proof
+int uci_stop;
+int uci_quit;
+
+// Init proof-number hash table
+void init_pn_table(int mb) {
+    // Free hash table if not empty
+    if (pn_table != NULL) free(pn_table);
+
+    // Init number of hash entries
+    pn_entries = (int)((mb * 0x100000LL) / sizeof(pn_entry));
+
+    // Allocate cleared memory
+    pn_table = calloc(pn_entries, sizeof(pn_entry));
+
+    // Retry with half the size if allocation fails
+    if (pn_table == NULL && mb > 1) init_pn_table(mb / 2);
+}
+
+// Position key of the board position with given attacker moves left
+static inline U64 pn_key(int moves_left) {
+    return hash_key ^ (moves_left * 0x9e3779b97f4a7c15ULL);
+}
+
+// Read proof & disproof numbers (unexpanded nodes count as 1, 1)
+static inline void pn_probe(U64 key, int *pn, int *dn) {
+    pn_entry *entry = &pn_table[key % pn_entries];
+
+    if (entry->key == key) {
+        *pn = entry->pn;
+        *dn = entry->dn;
+    }
+
+    else *pn = *dn = 1;
+}
+
+// Write proof & disproof numbers (always replace)
+static inline void pn_store(U64 key, int pn, int dn) {
+    pn_entry *entry = &pn_table[key % pn_entries];
+    entry->key = key;
+    entry->pn = pn;
+    entry->dn = dn;
+}
+
+// Check whether side to move is in check
+static inline int side_in_check() {
+    return is_square_attacked(get_ls1b_index(bitboards[side == white ? K : k]), side ^ 1);
+}
+
+// Generate pseudo legal moves that may give check (direct checks, discovered checks, en passant & castling)
+static inline void generate_checks(moves *move_list) {
+    // Generate all moves
+    moves all_list[1];
+    generate_moves(all_list);
+
+    // Squares checking the enemy king for each piece type
+    int king_square = get_ls1b_index(bitboards[side == white ? k : K]);
+    U64 bishop_checks = get_bishop_attacks(king_square, occupancies[both]);
+    U64 rook_checks = get_rook_attacks(king_square, occupancies[both]);
+
+    U64 check_squares[6] = {
+        pawn_attacks[side ^ 1][king_square], knight_attacks[king_square],
+        bishop_checks, rook_checks, bishop_checks | rook_checks, 0
+    };
+
+    // Own pieces on lines from the enemy king may uncover a check
+    U64 blockers = (bishop_checks | rook_checks) & occupancies[side];
+
+    // Keep check candidates
+    move_list->count = 0;
+
+    for (int count = 0; count < all_list->count; count++) {
+        int move = all_list->moves[count];
+        int piece = (get_move_promoted(move) ? get_move_promoted(move) : get_move_piece(move)) % 6;
+
+        if ((check_squares[piece] & (1ULL << get_move_target(move))) ||
+            (blockers & (1ULL << get_move_source(move))) ||
+            get_move_enpassant(move) || get_move_castling(move))
+            move_list->moves[move_list->count++] = move;
+    }
+}
+
+// Generate legal children: checks for the attacker, all moves for the defender (returns number of children)
+static inline int pn_children(int attacking, moves *move_list) {
+    if (attacking) generate_checks(move_list);
+    else generate_moves(move_list);
+
+    int count = 0;
+
+    for (int index = 0; index < move_list->count; index++) {
+        int move = move_list->moves[index];
+
+        // Preserve board state
+        copy_board();
+
+        // Skip illegal moves
+        if (!make_move(move, all_moves)) continue;
+
+        // Skip attacker moves not giving check after all
+        int legal = !attacking || side_in_check();
+
+        // Restore board state
+        take_back();
+
+        if (legal) move_list->moves[count++] = move;
+    }
+
+    return move_list->count = count;
+}
+
+// Check whether GUI input is waiting on stdin
+static int input_waiting() {
+#ifdef WIN64
+    static int init = 0, pipe;
+    static HANDLE handle;
+    DWORD events;
+
+    // Console input counts events, piped input counts bytes
+    if (!init) {
+        init = 1;
+        handle = GetStdHandle(STD_INPUT_HANDLE);
+        pipe = !GetConsoleMode(handle, &events);
+    }
+
+    if (pipe) return !PeekNamedPipe(handle, NULL, 0, NULL, &events, NULL) || events;
+
+    GetNumberOfConsoleInputEvents(handle, &events);
+    return events > 1;
+#else
+    fd_set read_fds;
+    struct timeval timeout = {0, 0};
+
+    FD_ZERO(&read_fds);
+    FD_SET(fileno(stdin), &read_fds);
+
+    return select(fileno(stdin) + 1, &read_fds, NULL, NULL, &timeout) > 0;
+#endif
+}
+
+// Answer GUI input arriving while proving (stdin is unbuffered in UCI mode)
+static void read_input() {
+    char input[256];
+
+    // End of input quits like "quit"
+    if (!fgets(input, sizeof(input), stdin) || !strncmp(input, "quit", 4)) uci_stop = uci_quit = 1;
+    else if (!strncmp(input, "stop", 4)) uci_stop = 1;
+    else if (!strncmp(input, "isready", 7)) printf("readyok\n");
+}
+
+// Stop proving once the deadline passed or the GUI said so (checked every 2048 nodes)
+static inline void pn_check_input() {
+    if (pn_poll_input && input_waiting()) read_input();
+
+    if (uci_stop || (pn_stop_time && get_time_ms() - pn_stop_time > 0)) stopped = 1;
+}
+
+// Expand position on the board until its proof or disproof number reaches the threshold
+static void pn_search(int attacking, int moves_left, int pn_threshold, int dn_threshold) {
+    // Init position key
+    U64 key = pn_key(moves_left);
+    pn_nodes++;
+
+    // Poll GUI & deadline
+    if ((pn_nodes & 2047) == 0) pn_check_input();
+
+    // Attacker out of moves
+    if (attacking && !moves_left) {
+        pn_store(key, pn_infinite, 0);
+        return;
+    }
+
+    // Generate children
+    moves move_list[1];
+    int count = pn_children(attacking, move_list);
+
+    // Defender without moves is mated, attacker without checks or defender escaping the last check wins nothing
+    if (!count || (!attacking && !moves_left)) {
+        if (!count && !attacking) pn_store(key, 0, pn_infinite);
+        else pn_store(key, pn_infinite, 0);
+        return;
+    }
+
+    // Children position keys
+    U64 child_keys[256];
+
+    for (int index = 0; index < count; index++) {
+        copy_board();
+        make_move(move_list->moves[index], all_moves);
+        child_keys[index] = pn_key(attacking ? moves_left - 1 : moves_left);
+        take_back();
+    }
+
+    while (1) {
+        /*
+            Attacker (OR) node: pn = min child pn, dn = sum of child dn
+            Defender (AND) node: pn = sum of child pn, dn = min child dn
+        */
+        int best = 0, smallest = pn_infinite, second = pn_infinite, sum = 0, best_pn = 0, best_dn = 0;
+
+        for (int index = 0; index < count; index++) {
+            int child_pn, child_dn;
+            pn_probe(child_keys[index], &child_pn, &child_dn);
+
+            int minimized = attacking ? child_pn : child_dn;
+            int summed = attacking ? child_dn : child_pn;
+
+            // Sum saturates below infinity unless some child is solved against this node
+            if (summed >= pn_infinite) sum = pn_infinite;
+            else if (sum < pn_infinite) sum = sum + summed < pn_infinite ? sum + summed : pn_infinite - 1;
+
+            if (minimized < smallest) {
+                second = smallest;
+                smallest = minimized;
+                best = index;
+                best_pn = child_pn;
+                best_dn = child_dn;
+            }
+
+            else if (minimized < second) second = minimized;
+        }
+
+        int pn = attacking ? smallest : sum;
+        int dn = attacking ? sum : smallest;
+        pn_store(key, pn, dn);
+
+        // Thresholds reached, node solved, out of nodes or stopped
+        if (pn >= pn_threshold || dn >= dn_threshold || pn_nodes >= pn_node_limit || stopped) return;
+
+        // Search best child until it's no longer best
+        int child_pn_threshold, child_dn_threshold;
+        int limit = second < pn_infinite ? second + 1 : pn_infinite;
+
+        if (attacking) {
+            child_pn_threshold = pn_threshold < limit ? pn_threshold : limit;
+            child_dn_threshold = dn_threshold - dn + best_dn;
+        }
+
+        else {
+            child_pn_threshold = pn_threshold - pn + best_pn;
+            child_dn_threshold = dn_threshold < limit ? dn_threshold : limit;
+        }
+
+        copy_board();
+        make_move(move_list->moves[best], all_moves);
+        pn_search(attacking ^ 1, attacking ? moves_left - 1 : moves_left, child_pn_threshold, child_dn_threshold);
+        take_back();
+    }
+}
+
+// Fewest attacker moves mating from the position on the board, solving shorter mates on demand (pn_infinite if none)
+static int pn_proven_moves(int attacking, int moves_left) {
+    for (int proven_moves = 0; proven_moves <= moves_left; proven_moves++) {
+        int pn, dn;
+        pn_probe(pn_key(proven_moves), &pn, &dn);
+
+        // Not solved for this many moves yet
+        if (pn && dn) {
+            pn_search(attacking, proven_moves, pn_infinite, pn_infinite);
+            pn_probe(pn_key(proven_moves), &pn, &dn);
+        }
+
+        if (pn == 0) return proven_moves;
+    }
+
+    return pn_infinite;
+}
+
+// Follow proven children into mating line: fastest check, slowest evasion (returns line length)
+static int pn_mating_line(int attacking, int moves_left, int *line) {
+    // Generate children
+    moves move_list[1];
+    int count = pn_children(attacking, move_list);
+    int best_move = 0, best_moves = attacking ? pn_infinite : -1;
+
+    for (int index = 0; index < count; index++) {
+        int move = move_list->moves[index];
+
+        copy_board();
+        make_move(move, all_moves);
+        int proven_moves = pn_proven_moves(attacking ^ 1, attacking ? moves_left - 1 : moves_left);
+        take_back();
+
+        // Skip children not proven (or no longer in the hash table)
+        if (proven_moves == pn_infinite) continue;
+
+        if (attacking ? proven_moves < best_moves : proven_moves > best_moves) {
+            best_move = move;
+            best_moves = proven_moves;
+        }
+    }
+
+    if (!best_move) return 0;
+
+    // Follow best child
+    line[0] = best_move;
+    copy_board();
+    make_move(best_move, all_moves);
+    int length = 1 + pn_mating_line(attacking ^ 1, best_moves, line + 1);
+    take_back();
+
+    return length;
+}
+
+// Prove shortest checking mate within max_moves (returns mate length, 0 if disproven, -1 if out of nodes or stopped)
+int mate_search(int max_moves, int *line, int *length) {
+    // Init hash table on first use, solved entries stay valid for later searches
+    if (pn_table == NULL) init_pn_table(pn_default_hash);
+
+    pn_nodes = 0;
+    stopped = 0;
+    *length = 0;
+
+    for (int mate_moves = 1; mate_moves <= max_moves; mate_moves++) {
+        pn_search(1, mate_moves, pn_infinite, pn_infinite);
+
+        int pn, dn;
+        pn_probe(pn_key(mate_moves), &pn, &dn);
+
+        // Proven, collect mating line
+        if (pn == 0) {
+            *length = pn_mating_line(1, mate_moves, line);
+            return mate_moves;
+        }
+
+        // Out of nodes or stopped before solving
+        if (dn != 0 || stopped) return -1;
+    }
+
+    // No checking mate within max_moves
+    return 0;
+}
+
+// Print mate search result of the position on the board
+void print_mate_search(int max_moves) {
+    int line[max_ply], length;
+    int start = get_time_ms();
+
+    int result = mate_search(max_moves, line, &length);
+    int time = get_time_ms() - start;
+
+    if (result > 0) {
+        printf("     proof: mate in %d\n     line: ", result);
+        for (int count = 0; count < length; count++) {
+            print_move(line[count]);
+            printf(count + 1 < length ? " " : "\n");
+        }
+    }
+
+    else if (result == 0) printf("     disproof: no checking mate in %d\n", max_moves);
+    else printf("     unknown: node limit of %ld reached\n", pn_node_limit);
+
+    printf("     nodes: %ld  time: %d ms  nps: %ld\n", pn_nodes, time, time ? pn_nodes * 1000 / time : pn_nodes);
+}
+
+// Answer UCI "go mate N" with a proven checking mate by the deadline (returns 0 if none was found)
+int uci_mate(int max_moves, int deadline) {
+    uci_stop = 0;
+    if (max_moves < 1 || 2 * max_moves >= max_ply) return 0;
+
+    int line[max_ply], length;
+    int start = get_time_ms();
+
+    // Keep answering the GUI while proving
+    pn_poll_input = 1;
+    pn_stop_time = deadline;
+    int result = mate_search(max_moves, line, &length);
+    pn_poll_input = 0;
+    pn_stop_time = 0;
+
+    if (result <= 0 || !length) return 0;
+
+    printf("info depth %d score mate %d nodes %ld time %d pv ", length, (length + 1) / 2, pn_nodes,
+           get_time_ms() - start);
+
+    for (int count = 0; count < length; count++) {
+        print_move(line[count]);
+        printf(count + 1 < length ? " " : "\n");
+    }
+
+    printf("bestmove ");
+    print_move(line[0]);
+    printf("\n");
+    return 1;
+}
+
+// Mate puzzles solved by "mate": FEN & shortest checking mate
+typedef struct {
+    const char *fen;
+    int mate;
+} mate_puzzle;
+
+const mate_puzzle mate_positions[] = {
+    { "6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - 0 1", 1 },
+    { "r2qkb1r/pp2nppp/3p4/2pNN1B1/2BnP3/3P4/PPP2PPP/R2bK2R w KQkq - 1 1", 2 },
+    { "r1b1kb1r/pppp1ppp/5q2/4n3/3KP3/2N3PN/PPP4P/R1BQ1B1R b kq - 0 1", 3 },
+    { "r6k/pp4pp/8/4N3/2Q5/8/PP3PPP/6K1 w - - 0 1", 4 },
+    { "rn3rk1/pbppq1pp/1p2pb2/4N2Q/3PN3/3B4/PPP2PPP/R3K2R w KQ - 0 11", 7 },
+    { tricky_position, 0 }
+};
+
+// Node limit of the alpha-beta search "mate" compares with
+#define mate_compare_nodes 2000000
+
+/*
+    "chengine mate N [fen]" proves or disproves a checking mate in N moves
+    of the given position. Without a FEN it runs the built-in puzzles & the
+    tricky position (no mate) & compares with the alpha-beta search to the
+    depth a mate needs (plies of the expected mate or of N moves, one more
+    to see the mated side has no moves).
+*/
+int mate(int argc, char *argv[]) {
+    int max_moves = atoi(argv[2]);
+    if (max_moves < 1 || 2 * max_moves >= max_ply) max_moves = max_moves < 1 ? 1 : max_ply / 2 - 1;
+
+    // Single position
+    if (argc > 3) {
+        char fen[256] = "";
+
+        for (int arg = 3; arg < argc; arg++) {
+            strncat(fen, argv[arg], sizeof(fen) - strlen(fen) - 2);
+            strcat(fen, " ");
+        }
+
+        if (parse_fen(fen) != fen_ok) {
+            printf("     Invalid FEN\n");
+            return 1;
+        }
+
+        print_mate_search(max_moves);
+        return 0;
+    }
+
+    // Built-in puzzles
+    int count = sizeof(mate_positions) / sizeof(mate_positions[0]);
+
+    for (int index = 0; index < count; index++) {
+        if (parse_fen((char *)mate_positions[index].fen) != fen_ok) continue;
+
+        printf("\n     %s (expected: %s", mate_positions[index].fen, mate_positions[index].mate ? "mate in " : "no mate");
+        if (mate_positions[index].mate) printf("%d", mate_positions[index].mate);
+        printf(")\n");
+
+        print_mate_search(max_moves);
+
+        // Alpha-beta search to the depth of the mate for comparison
+        int depth = 2 * (mate_positions[index].mate ? mate_positions[index].mate : max_moves);
+        int score, start = get_time_ms();
+        time_set = 0;
+        node_limit = mate_compare_nodes;
+        clear_hash_table();
+        int completed_depth = iterative_deepening(depth, &score, 0);
+        node_limit = 0;
+
+        printf("     alpha-beta depth %d/%d: ", completed_depth, depth);
+        if (score > mate_score) printf("mate in %d", (mate_value - score + 1) / 2);
+        else printf("score cp %d", score);
+        printf("  nodes: %ld  time: %d ms\n", nodes, get_time_ms() - start);
+    }
+
+    printf("\n");
+    return 0;
+}
+
+/* ======================================================================== */
+/* ================================= UCI ================================== */
+/* ======================================================================== */
+
+// Parse UCI "position" command
+void parse_position(char *command) {
+    // Shift pointer to the right where next token begins
+    command += 9;
+
+    // Init pointer to the current character in the command string
+    char *current_char = command;
+
+    // Parse UCI "startpos" command
+    if (strncmp(command, "startpos", 8) == 0)
+        parse_fen(start_position);
+
+    // Parse UCI "fen" command
+    else {
+        // Make sure "fen" command is available within command string
+        current_char = strstr(command, "fen");
+
+        // FEN ends where the move list begins
+        char fen[256] = "";
+        char *moves_string = strstr(command, "moves");
+
+        if (current_char != NULL) {
+            int length = (moves_string != NULL && moves_string > current_char) ? moves_string - current_char - 4 : 255;
+            snprintf(fen, sizeof(fen), "%.*s", length > 0 ? length : 0, current_char + 4);
+        }
+
+        // If no "fen" command is available within command string, init chess board with start position
+        if (current_char == NULL || parse_fen(fen) != fen_ok)
+            parse_fen(start_position);
+    }
+
+    // Parse moves after position
+    current_char = strstr(command, "moves");
+
+    // Moves available
+    if (current_char != NULL) {
+        // Shift pointer to the right where next token begins
+        current_char += 6;
+
+        // Loop over moves within a move string
+        while (*current_char) {
+            // Parse next move
+            int move = parse_move(current_char);
+
+            // If no more moves
+            if (move == 0) break;
+
+            // Drop history no repetition scan can reach (search stops at fifty move rule anyway)
+            if (repetition_index > max_history - 2 * max_ply) {
+                memmove(repetition_table, repetition_table + repetition_index - 100, 100 * sizeof(U64));
+                repetition_index = 100;
+            }
+
+            // Make move on the chess board
+            make_move(move, all_moves);
+
+            // Move current character pointer to the end of current move
+            while (*current_char && *current_char != ' ') current_char++;
+
+            // Go to the next move
+            if (*current_char) current_char++;
+        }
+    }
+}
+
+// Parse UCI "go" command
+void parse_go(char *command) {
+    // Init depth & time control
+    int depth = -1, time = -1, increment = 0, moves_to_go = default_moves_to_go, move_time = -1;
+    char *argument = NULL;
+
+    // Start clock as early as possible
+    int start = get_time_ms();
+
+    // Handle fixed depth search
+    if ((argument = strstr(command, "depth"))) depth = atoi(argument + 6);
+
+    // Parse remaining time & increment of the side to move
+    if ((argument = strstr(command, side == white ? "wtime" : "btime"))) time = atoi(argument + 6);
+    if ((argument = strstr(command, side == white ? "winc" : "binc"))) increment = atoi(argument + 5);
+
+    // Parse moves to the next time control
+    if ((argument = strstr(command, "movestogo")) && atoi(argument + 10) > 0) moves_to_go = atoi(argument + 10);
+
+    // Parse fixed time per move
+    if ((argument = strstr(command, "movetime"))) move_time = atoi(argument + 9);
+
+    // Init time control
+    time_set = 0;
+
+    if (move_time >= 0) {
+        // Spend all of the move time
+        time_set = 1;
+        soft_time = stop_time = start + (move_time > move_overhead ? move_time - move_overhead : 1);
+    }
+
+    else if (time >= 0) {
+        // Share remaining time between moves to go, spend most of the increment, never flag
+        int limit = time > 2 * move_overhead ? time - 2 * move_overhead : time / 2;
+        int budget = time / moves_to_go + increment * 3 / 4;
+        if (budget > limit) budget = limit;
+
+        // Don't start an iteration past half of the budget
+        time_set = 1;
+        stop_time = start + budget;
+        soft_time = start + budget / 2;
+    }
+
+    // Search as deep as time allows, fixed depth defaults to 6 plies
+    if (depth == -1) depth = time_set ? max_ply - 1 : 6;
+
+    // Keep depth within search stack limits
+    if (depth < 1) depth = 1;
+    if (depth > max_ply - 1) depth = max_ply - 1;
+
+    // Prove checking mate first when asked for one (within half of the move's time), search normally if none is found
+    if ((argument = strstr(command, "mate"))) {
+        if (uci_mate(atoi(argument + 5), time_set ? start + (stop_time - start) / 2 : 0)) return;
+
+        // Stopped while proving, answer with a quick search
+        if (uci_stop) {
+            time_set = 0;
+            depth = 1;
+        }
+    }
+
+    // Search position
+    search_position(depth);
+}
+
+// Parse UCI "setoption" command
+void parse_setoption(char *command) {
+    // Init pointer to option value
+    char *value = strstr(command, "value ");
+    if (value == NULL) return;
+    value += 6;
+
+    // Strip line break
+    value[strcspn(value, "\r\n")] = '\0';
+
+    // Hash table size
+    if (strstr(command, "name Hash ") != NULL) {
+        int mb = atoi(value);
+        init_hash_table(mb < 1 ? 1 : mb > 4096 ? 4096 : mb);
+    }
+
+    // Opening book file (empty value closes the book)
+    else if (strstr(command, "name BookFile ") != NULL) {
+        if (*value && strcmp(value, "<empty>") && !book_open(value))
+            printf("info string can't open book %s\n", value);
+        else if (!*value || !strcmp(value, "<empty>"))
+            book_close();
+    }
+
+    // Endgame bitbases
+    else if (strstr(command, "name Bitbases ") != NULL)
+        use_bitbases = !strncmp(value, "true", 4);
+
+    // Search threads
+    else if (strstr(command, "name Threads ") != NULL) {
+        thread_count = atoi(value);
+        if (thread_count < 1) thread_count = 1;
+        if (thread_count > max_threads) thread_count = max_threads;
+    }
+
+    // Number of principal variations
+    else if (strstr(command, "name MultiPV ") != NULL) {
+        multi_pv = atoi(value);
+        if (multi_pv < 1) multi_pv = 1;
+        if (multi_pv > max_multi_pv) multi_pv = max_multi_pv;
+    }
+
+    // NUMA thread pinning & hash table placement
+    else if (strstr(command, "name NumaPinning ") != NULL)
+        use_numa_pinning = !strncmp(value, "true", 4);
+
+    // Principal variation search & aspiration windows
+    else if (strstr(command, "name PVS ") != NULL)
+        use_pvs = !strncmp(value, "true", 4);
+
+    else if (strstr(command, "name AspirationWindows ") != NULL)
+        use_aspiration = !strncmp(value, "true", 4);
+
+    // Selective search toggles
+    else if (strstr(command, "name NullMove ") != NULL)
+        use_null_move = !strncmp(value, "true", 4);
+
+    else if (strstr(command, "name LateMoveReductions ") != NULL)
+        use_lmr = !strncmp(value, "true", 4);
+
+    else if (strstr(command, "name Futility ") != NULL)
+        use_futility = !strncmp(value, "true", 4);
+
+    else if (strstr(command, "name ReverseFutility ") != NULL)
+        use_reverse_futility = !strncmp(value, "true", 4);
+
+    // Directory of tables written by tb-generate, not Syzygy (empty value disables probing)
+    else if (strstr(command, "name TablebasePath ") != NULL) {
+        tb_close();
+        snprintf(tb_path, sizeof(tb_path), "%s", strcmp(value, "<empty>") ? value : "");
+    }
+}
+
+// Main UCI loop
+void uci_loop() {
+    // Reset stdin & stdout buffers
+    setbuf(stdin, NULL);
+    setbuf(stdout, NULL);
+
+    // Define user / GUI input buffer
+    char input[10000];
+
+    // Main loop
+    while (1) {
+        // Reset user / GUI input
+        memset(input, 0, sizeof(input));
+
+        // Make sure output reaches the GUI
+        fflush(stdout);
+
+        // Get user / GUI input, quit on end of input
+        if (!fgets(input, sizeof(input), stdin)) break;
+
+        // Make sure input is available
+        if (input[0] == '\n') continue;
+
+        // Parse UCI "isready" command
+        if (strncmp(input, "isready", 7) == 0)
+            printf("readyok\n");
+
+        // Parse UCI "position" command
+        else if (strncmp(input, "position", 8) == 0)
+            parse_position(input);
+
+        // Parse UCI "ucinewgame" command
+        else if (strncmp(input, "ucinewgame", 10) == 0) {
+            parse_position("position startpos");
+            clear_hash_table();
+        }
+
+        // Parse UCI "go" command
+        else if (strncmp(input, "go", 2) == 0) {
+            parse_go(input);
+
+            // GUI quit during the search
+            if (uci_quit) break;
+        }
+
+        // Parse UCI "setoption" command
+        else if (strncmp(input, "setoption", 9) == 0)
+            parse_setoption(input);
+
+        // Parse UCI "quit" command
+        else if (strncmp(input, "quit", 4) == 0)
+            break;
+
+        // Parse UCI "uci" command
+        else if (strncmp(input, "uci", 3) == 0) {
+            printf("id name chengine\n");
+            printf("id author AmaiRivas\n");
+            printf("option name Hash type spin default %d min 1 max 4096\n", hash_size_default);
+            printf("option name Threads type spin default 1 min 1 max %d\n", max_threads);
+            printf("option name MultiPV type spin default 1 min 1 max %d\n", max_multi_pv);
+            printf("option name NumaPinning type check default true\n");
+            printf("option name BookFile type string default <empty>\n");
+            printf("option name Bitbases type check default true\n");
+            printf("option name TablebasePath type string default <empty>\n");
+            printf("option name PVS type check default true\n");
+            printf("option name AspirationWindows type check default true\n");
+            printf("option name NullMove type check default true\n");
+            printf("option name LateMoveReductions type check default true\n");
+            printf("option name Futility type check default true\n");
+            printf("option name ReverseFutility type check default true\n");
+            printf("uciok\n");
+        }
+
+        // Print tablebase probe counters & latency histograms
+        else if (strncmp(input, "tbstats", 7) == 0)
+            tb_print_stats();
+
+        // Print board (debugging aid)
+        else if (strncmp(input, "d", 1) == 0)
+            print_board();
+    }
+}
+
+/* ======================================================================== */
+/* ============================= Match runner ============================= */
+/* ======================================================================== */
+
+/*
+    Plays games between two UCI engines to accept or reject engine changes.
+    Every game slot owns one process of each engine & all slots are served by
+    a single poll() loop, so games run concurrently while engines do the
+    thinking on their own cores. Openings are played twice with colors
+    reversed. Games end by the rules (mate, stalemate, threefold repetition,
+    fifty move rule, insufficient material), on time, on illegal moves or by
+    score adjudication. After every game a sequential probability ratio test
+    checks whether the Elo difference is more likely elo1 than elo0, so the
+    match stops as soon as the result is significant.
+*/
+
+#ifndef WIN64
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+// Engine output line buffer size
+#define match_buffer_size 16384
+
+// Position command buffer size ("position fen ... moves ...")
+#define match_command_size 8192
+
+// Game length limit in plies (adjudicated as draw)
+#define match_max_plies 600
+
+// Max concurrent games
+#define match_max_slots 256
+
+// Resign adjudication: score at or below -resign for the given number of own moves
+#define match_resign_score 1000
+#define match_resign_moves 3
+
+// Draw adjudication: both scores within draw score for the given number of moves after draw ply
+#define match_draw_score 10
+#define match_draw_moves 8
+#define match_draw_ply 80
+
+// Time an engine may exceed its clock before it's considered hung
+#define match_hang_margin 5000
+
+// Game results from first engine's point of view
+enum { match_loss, match_draw, match_win };
+
+// UCI engine child process
+typedef struct {
+    // Process id, pipes to engine's stdin & from engine's stdout
+    pid_t pid;
+    int in, out;
+
+    // Partial output not yet split into lines
+    char buffer[match_buffer_size];
+    int length;
+
+    // Last score reported by the engine (side to move's point of view)
+    int score;
+} match_engine;
+
+// Game slot running one game at a time
+typedef struct {
+    // First & second engine
+    match_engine engines[2];
+
+    // Game in progress, waiting for "readyok" from both engines
+    int active;
+    int ready;
+
+    // Game number & whether first engine plays white
+    int game;
+    int first_white;
+
+    // Position command sent to engines & plies played
+    char command[match_command_size];
+    int plies;
+
+    // Side to move, clocks per color & time when "go" was sent
+    int side;
+    int clock[2];
+    long long go_time;
+
+    // Adjudication counters: consecutive resigning moves per color, consecutive drawish plies
+    int resign_count[2];
+    int draw_count;
+} match_slot;
+
+// Match settings
+typedef struct {
+    const char *engine_paths[2];
+    int games;
+    int concurrency;
+    int base_time;
+    int increment;
+    double elo0, elo1, alpha, beta;
+} match_settings;
+
+// Match slots
+match_slot *match_slots;
+
+// Opening FENs
+char **match_openings;
+int match_opening_count;
+
+// Default openings
+const char *match_default_openings[] = { start_position, tricky_position, killer_position, cmk_position };
+
+// Get monotonic time in milliseconds
+static inline long long match_time() {
+    return get_time_ns() / 1000000;
+}
+
+// Start engine child process (returns 0 on failure)
+int start_engine(match_engine *engine, const char *path) {
+    // Init pipes
+    int to_engine[2], from_engine[2];
+    if (pipe(to_engine)) return 0;
+    if (pipe(from_engine)) { close(to_engine[0]); close(to_engine[1]); return 0; }
+
+    // Keep our pipe ends away from other engines
+    fcntl(to_engine[1], F_SETFD, FD_CLOEXEC);
+    fcntl(from_engine[0], F_SETFD, FD_CLOEXEC);
+
+    // Spawn engine
+    engine->pid = fork();
+
+    if (engine->pid == 0) {
+        // Connect standard streams to pipes & run engine
+        dup2(to_engine[0], STDIN_FILENO);
+        dup2(from_engine[1], STDOUT_FILENO);
+        close(to_engine[0]);
+        close(from_engine[1]);
+        execl(path, path, (char *)NULL);
+        _exit(127);
+    }
+
+    // Close child's pipe ends
+    close(to_engine[0]);
+    close(from_engine[1]);
+
+    engine->in = to_engine[1];
+    engine->out = from_engine[0];
+    engine->length = 0;
+    engine->score = 0;
+
+    if (engine->pid < 0) {
+        close(engine->in);
+        close(engine->out);
+        return 0;
+    }
+
+    return 1;
+}
+
+// Stop engine child process
+void stop_engine(match_engine *engine) {
+    if (engine->pid <= 0) return;
+
+    // Ask politely, then make sure
+    dprintf(engine->in, "quit\n");
+    close(engine->in);
+    close(engine->out);
+    kill(engine->pid, SIGTERM);
+    waitpid(engine->pid, NULL, 0);
+    engine->pid = 0;
+}
+
+// Read available engine output (returns 0 on end of output)
+int read_engine(match_engine *engine) {
+    // Drop overlong line rather than stall
+    if (engine->length == match_buffer_size - 1) engine->length = 0;
+
+    int count = read(engine->out, engine->buffer + engine->length, match_buffer_size - 1 - engine->length);
+    if (count <= 0) return 0;
+
+    engine->length += count;
+    return 1;
+}
+
+// Pop next complete output line (returns 0 if no complete line is buffered)
+int next_engine_line(match_engine *engine, char *line) {
+    char *end = memchr(engine->buffer, '\n', engine->length);
+    if (end == NULL) return 0;
+
+    // Copy line without line ending
+    int length = end - engine->buffer;
+    memcpy(line, engine->buffer, length);
+    line[length] = '\0';
+    if (length && line[length - 1] == '\r') line[length - 1] = '\0';
+
+    // Shift remaining output
+    engine->length -= length + 1;
+    memmove(engine->buffer, end + 1, engine->length);
+
+    return 1;
+}
+
+// Wait for the given output line from engine (returns 0 on timeout or end of output)
+int wait_engine_line(match_engine *engine, const char *expected, int timeout) {
+    char line[match_buffer_size];
+    long long deadline = match_time() + timeout;
+
+    while (1) {
+        // Check buffered lines
+        while (next_engine_line(engine, line))
+            if (!strcmp(line, expected)) return 1;
+
+        // Wait for more output
+        struct pollfd descriptor = { engine->out, POLLIN, 0 };
+        int left = deadline - match_time();
+
+        if (left <= 0 || poll(&descriptor, 1, left) <= 0 || !read_engine(engine)) return 0;
+    }
+}
+
+// Start engine & complete UCI handshake (returns 0 on failure)
+int init_engine(match_engine *engine, const char *path) {
+    if (!start_engine(engine, path)) return 0;
+
+    dprintf(engine->in, "uci\n");
+
+    if (!wait_engine_line(engine, "uciok", 10000)) {
+        stop_engine(engine);
+        return 0;
+    }
+
+    return 1;
+}
+
+// Load opening FENs from file, one per line (returns number of openings)
+int load_openings(const char *path) {
+    // Use default openings without file, validated like file openings
+    if (path == NULL) {
+        int count = sizeof(match_default_openings) / sizeof(match_default_openings[0]);
+        match_openings = malloc(count * sizeof(char *));
+
+        for (int index = 0; index < count; index++) {
+            if (parse_fen(match_default_openings[index]) != fen_ok) {
+                printf("     Skipped invalid default opening %s\n", match_default_openings[index]);
+                continue;
+            }
+
+            match_openings[match_opening_count++] = strdup(match_default_openings[index]);
+        }
+
+        return match_opening_count;
+    }
+
+    FILE *file = fopen(path, "r");
+
+    if (file == NULL) {
+        printf("     Can't open %s\n", path);
+        return 0;
+    }
+
+    char line[1024];
+    int capacity = 0, fen_errors = 0;
+
+    while (fgets(line, sizeof(line), file)) {
+        // Strip line ending & skip empty lines
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!line[0]) continue;
+
+        // Skip invalid positions
+        if (parse_fen(line) != fen_ok) {
+            fen_errors++;
+            continue;
+        }
+
+        // Grow openings array
+        if (match_opening_count == capacity) {
+            capacity = capacity ? 2 * capacity : 1024;
+            match_openings = realloc(match_openings, capacity * sizeof(char *));
+        }
+
+        match_openings[match_opening_count++] = strdup(line);
+    }
+
+    fclose(file);
+
+    if (fen_errors) printf("     Skipped %d invalid openings\n", fen_errors);
+
+    return match_opening_count;
+}
+
+// Convert score fraction into Elo difference
+double score_to_elo(double score) {
+    return -400.0 * log10(1.0 / score - 1.0);
+}
+
+// Convert Elo difference into expected score
+double elo_to_score(double elo) {
+    return 1.0 / (1.0 + pow(10.0, -elo / 400.0));
+}
+
+// Log likelihood ratio of elo1 against elo0 (normal approximation of trinomial results)
+double sprt_llr(int wins, int draws, int losses, double elo0, double elo1) {
+    int games = wins + draws + losses;
+    if (!games) return 0.0;
+
+    // Result frequencies, mean score & per game variance
+    double win = (double)wins / games, draw = (double)draws / games, loss = (double)losses / games;
+    double score = win + draw / 2;
+    double variance = win * (1 - score) * (1 - score) + draw * (0.5 - score) * (0.5 - score) + loss * score * score;
+
+    // No information without variance
+    if (variance <= 0.0) return 0.0;
+
+    double score0 = elo_to_score(elo0), score1 = elo_to_score(elo1);
+
+    return games * (score1 - score0) * (2 * score - score0 - score1) / (2 * variance);
+}
+
+// Print Elo difference with 95% confidence interval
+void print_elo(int wins, int draws, int losses) {
+    int games = wins + draws + losses;
+    double score = (wins + draws / 2.0) / games;
+
+    // Elo is infinite with a perfect or zero score
+    if (score <= 0.0 || score >= 1.0) {
+        printf("Elo: %s", score > 0.5 ? "+inf" : "-inf");
+        return;
+    }
+
+    double variance = ((double)wins * (1 - score) * (1 - score) + draws * (0.5 - score) * (0.5 - score) +
+                       (double)losses * score * score) / games;
+    double margin = 1.96 * sqrt(variance / games);
+
+    double low = score - margin > 0.0 ? score_to_elo(score - margin) : -INFINITY;
+    double high = score + margin < 1.0 ? score_to_elo(score + margin) : INFINITY;
+
+    printf("Elo: %.1f +/- %.1f", score_to_elo(score), (high - low) / 2);
+}
+
+// Send position & clocks to the engine to move
+void send_go(match_slot *slot, match_settings *settings) {
+    match_engine *engine = &slot->engines[(slot->side == white) == slot->first_white ? 0 : 1];
+
+    dprintf(engine->in, "%s\ngo wtime %d btime %d winc %d binc %d\n", slot->command, slot->clock[white],
+            slot->clock[black], settings->increment, settings->increment);
+
+    slot->go_time = match_time();
+}
+
+// Start game in slot
+void start_game(match_slot *slot, int game, match_settings *settings) {
+    // Play each opening with both colors
+    const char *opening = match_openings[(game / 2) % match_opening_count];
+
+    slot->active = 1;
+    slot->ready = 0;
+    slot->game = game;
+    slot->first_white = !(game & 1);
+    slot->plies = 0;
+    slot->clock[white] = slot->clock[black] = settings->base_time;
+    slot->resign_count[white] = slot->resign_count[black] = 0;
+    slot->draw_count = 0;
+    snprintf(slot->command, match_command_size, "position fen %s", opening);
+
+    // Init side to move
+    parse_fen(opening);
+    slot->side = side;
+
+    // Reset engines, game starts once both are ready
+    for (int index = 0; index < 2; index++) {
+        slot->engines[index].score = 0;
+        dprintf(slot->engines[index].in, "ucinewgame\nisready\n");
+    }
+}
+
+// Neither side can mate (bare kings or a single minor piece)
+int insufficient_material() {
+    if (bitboards[P] | bitboards[p] | bitboards[R] | bitboards[r] | bitboards[Q] | bitboards[q]) return 0;
+
+    return count_bits(bitboards[N] | bitboards[n] | bitboards[B] | bitboards[b]) <= 1;
+}
+
+// Play move sent by the engine to move, returns game result or -1 if the game goes on
+int play_match_move(match_slot *slot, match_settings *settings, const char *move_string, const char **reason) {
+    int mover = slot->side;
+    int mover_is_first = (mover == white) == slot->first_white;
+
+    // Result for the side to move losing & winning
+    int loss = mover_is_first ? match_loss : match_win;
+    int win = mover_is_first ? match_win : match_loss;
+
+    // Update clock
+    slot->clock[mover] -= match_time() - slot->go_time;
+
+    if (slot->clock[mover] < 0) {
+        *reason = "time forfeit";
+        return loss;
+    }
+
+    slot->clock[mover] += settings->increment;
+
+    // Restore game position & validate move
+    parse_position(slot->command);
+    int move = parse_move(move_string);
+
+    if (!move) {
+        *reason = "illegal move";
+        return loss;
+    }
+
+    // Append move to position command
+    int length = strlen(slot->command);
+
+    if (length + 16 >= match_command_size) {
+        *reason = "game too long";
+        return match_draw;
+    }
+
+    snprintf(slot->command + length, match_command_size - length, "%s%.5s", slot->plies ? " " : " moves ",
+             move_string);
+
+    // Make move
+    make_move(move, all_moves);
+    slot->plies++;
+    slot->side = side;
+
+    // Checkmate or stalemate
+    if (!count_legal_moves()) {
+        int in_check = is_square_attacked(get_ls1b_index(bitboards[side == white ? K : k]), side ^ 1);
+        *reason = in_check ? "checkmate" : "stalemate";
+        return in_check ? win : match_draw;
+    }
+
+    // Draws by the rules (threefold repetition scans history since the last irreversible move)
+    int repetitions = 0;
+
+    for (int index = repetition_index - 2; index >= 0; index -= 2)
+        repetitions += repetition_table[index] == hash_key;
+
+    if (repetitions >= 2) { *reason = "threefold repetition"; return match_draw; }
+    if (fifty >= 100) { *reason = "fifty move rule"; return match_draw; }
+    if (insufficient_material()) { *reason = "insufficient material"; return match_draw; }
+    if (slot->plies >= match_max_plies) { *reason = "game too long"; return match_draw; }
+
+    // Resign adjudication: mover's own score stays hopeless
+    int score = slot->engines[mover_is_first ? 0 : 1].score;
+    slot->resign_count[mover] = score <= -match_resign_score ? slot->resign_count[mover] + 1 : 0;
+
+    if (slot->resign_count[mover] >= match_resign_moves) {
+        *reason = "resignation";
+        return loss;
+    }
+
+    // Draw adjudication: both sides keep scoring the game as dead even
+    slot->draw_count = (slot->plies >= match_draw_ply && abs(score) <= match_draw_score) ? slot->draw_count + 1 : 0;
+
+    if (slot->draw_count >= 2 * match_draw_moves) {
+        *reason = "draw adjudication";
+        return match_draw;
+    }
+
+    return -1;
+}
+
+// Parse score from engine "info" line
+void parse_info_score(match_engine *engine, const char *line) {
+    const char *score = strstr(line, " score ");
+    if (score == NULL) return;
+
+    if (!strncmp(score + 7, "cp ", 3))
+        engine->score = atoi(score + 10);
+
+    else if (!strncmp(score + 7, "mate ", 5))
+        engine->score = atoi(score + 12) > 0 ? mate_value - atoi(score + 12) : -mate_value - atoi(score + 12);
+}
+
+// Run match between two engines (returns 0 on success)
+int run_match(match_settings *settings) {
+    // Don't die when an engine exits early
+    signal(SIGPIPE, SIG_IGN);
+
+    int slots = settings->concurrency < settings->games ? settings->concurrency : settings->games;
+    match_slots = calloc(slots, sizeof(match_slot));
+
+    // Start engines
+    for (int slot = 0; slot < slots; slot++) {
+        for (int index = 0; index < 2; index++) {
+            if (!init_engine(&match_slots[slot].engines[index], settings->engine_paths[index])) {
+                printf("     Can't start engine %s\n", settings->engine_paths[index]);
+
+                // Stop engines started so far
+                for (int started = 0; started <= slot; started++)
+                    for (int other = 0; other < 2; other++) stop_engine(&match_slots[started].engines[other]);
+
+                free(match_slots);
+                return 1;
+            }
+        }
+    }
+
+    // SPRT bounds
+    double lower_bound = log(settings->beta / (1 - settings->alpha));
+    double upper_bound = log((1 - settings->beta) / settings->alpha);
+
+    printf("\n     %s vs %s: %d games, %d concurrent, tc %d+%d ms, %d openings\n",
+           settings->engine_paths[0], settings->engine_paths[1], settings->games, slots, settings->base_time,
+           settings->increment, match_opening_count);
+    printf("     SPRT elo0 %.1f elo1 %.1f alpha %.3f beta %.3f, LLR bounds [%.2f, %.2f]\n\n",
+           settings->elo0, settings->elo1, settings->alpha, settings->beta, lower_bound, upper_bound);
+
+    // Results from first engine's point of view
+    int results[3] = { 0 };
+    int next_game = 0, finished = 0, active = 0, error = 0;
+    double llr = 0.0;
+    const char *verdict = "inconclusive";
+    long long start = match_time();
+
+    // Start first games
+    for (int slot = 0; slot < slots; slot++) {
+        start_game(&match_slots[slot], next_game++, settings);
+        active++;
+    }
+
+    struct pollfd descriptors[2 * match_max_slots];
+    char line[match_buffer_size];
+
+    // Serve engines until all games are finished
+    while (active && !error) {
+        // Poll engines of active games
+        for (int slot = 0; slot < slots; slot++)
+            for (int index = 0; index < 2; index++) {
+                descriptors[2 * slot + index].fd = match_slots[slot].active ? match_slots[slot].engines[index].out : -1;
+                descriptors[2 * slot + index].events = POLLIN;
+                descriptors[2 * slot + index].revents = 0;
+            }
+
+        if (poll(descriptors, 2 * slots, 100) < 0) continue;
+
+        for (int slot = 0; slot < slots && !error; slot++) {
+            match_slot *game = &match_slots[slot];
+            if (!game->active) continue;
+
+            int result = -1;
+            const char *reason = NULL;
+
+            for (int index = 0; index < 2 && result == -1; index++) {
+                match_engine *engine = &game->engines[index];
+                if (!descriptors[2 * slot + index].revents) continue;
+
+                // Engine exited
+                if (!read_engine(engine)) {
+                    printf("     Engine %s exited unexpectedly\n", settings->engine_paths[index]);
+                    error = 1;
+                    break;
+                }
+
+                while (result == -1 && next_engine_line(engine, line)) {
+                    // Both engines are ready, white moves first
+                    if (!strcmp(line, "readyok")) {
+                        if (++game->ready == 2) send_go(game, settings);
+                    }
+
+                    // Keep last reported score for adjudication
+                    else if (!strncmp(line, "info ", 5))
+                        parse_info_score(engine, line);
+
+                    // Play move & let the opponent move
+                    else if (!strncmp(line, "bestmove ", 9)) {
+                        result = play_match_move(game, settings, line + 9, &reason);
+                        if (result == -1) send_go(game, settings);
+                    }
+                }
+            }
+
+            // Engine to move hangs long past its clock
+            if (result == -1 && !error && game->ready == 2 &&
+                match_time() - game->go_time > game->clock[game->side] + match_hang_margin) {
+                printf("     Engine %s doesn't respond\n",
+                       settings->engine_paths[(game->side == white) == game->first_white ? 0 : 1]);
+                error = 1;
+            }
+
+            if (result == -1) continue;
+
+            // Record result
+            results[result]++;
+            finished++;
+            game->active = 0;
+            active--;
+
+            printf("     Game %d: %s vs %s %s (%s, %d plies)\n", game->game + 1,
+                   settings->engine_paths[game->first_white ? 0 : 1], settings->engine_paths[game->first_white ? 1 : 0],
+                   result == match_draw ? "1/2-1/2" : (result == match_win) == game->first_white ? "1-0" : "0-1",
+                   reason, game->plies);
+
+            // Running score & SPRT
+            llr = sprt_llr(results[match_win], results[match_draw], results[match_loss], settings->elo0,
+                           settings->elo1);
+
+            printf("     Score: %d - %d - %d [%.3f] %d games, ", results[match_win], results[match_loss],
+                   results[match_draw], (results[match_win] + results[match_draw] / 2.0) / finished, finished);
+            print_elo(results[match_win], results[match_draw], results[match_loss]);
+            printf(", LLR %.2f\n", llr);
+
+            // Stop early once SPRT is decided
+            if (llr >= upper_bound || llr <= lower_bound) {
+                verdict = llr >= upper_bound ? "H1 accepted" : "H0 accepted";
+                next_game = settings->games;
+                active = 0;
+                break;
+            }
+
+            // Start next game in freed slot
+            if (next_game < settings->games) {
+                start_game(game, next_game++, settings);
+                active++;
+            }
+        }
+    }
+
+    // Stop engines
+    for (int slot = 0; slot < slots; slot++)
+        for (int index = 0; index < 2; index++) stop_engine(&match_slots[slot].engines[index]);
+
+    free(match_slots);
+
+    // Print summary
+    double minutes = (match_time() - start) / 60000.0;
+
+    if (finished) {
+        printf("\n     Finished %d games in %.1f s, %.1f games/min\n", finished, minutes * 60,
+               minutes > 0 ? finished / minutes : 0.0);
+        printf("     Score of %s vs %s: %d - %d - %d [%.3f]\n     ", settings->engine_paths[0],
+               settings->engine_paths[1], results[match_win], results[match_loss], results[match_draw],
+               (results[match_win] + results[match_draw] / 2.0) / finished);
+        print_elo(results[match_win], results[match_draw], results[match_loss]);
+        printf("\n     SPRT: LLR %.2f [%.2f, %.2f], %s\n\n", llr, lower_bound, upper_bound, verdict);
+    }
+
+    return error;
+}
+
+// Parse match options given as key=value & run match
+int match(int argc, char *argv[]) {
+    // Default settings: 10+0.1 s, one game per core, SPRT [0, 5] with 5% error rates
+    match_settings settings = { { argv[2], argv[3] }, 100, (int)sysconf(_SC_NPROCESSORS_ONLN), 10000, 100,
+                                0.0, 5.0, 0.05, 0.05 };
+    const char *openings = NULL;
+
+    for (int index = 4; index < argc; index++) {
+        char *value = strchr(argv[index], '=');
+
+        if (value == NULL) {
+            printf("     Unknown option %s\n", argv[index]);
+            return 1;
+        }
+
+        value++;
+
+        if (!strncmp(argv[index], "games=", 6)) settings.games = atoi(value);
+        else if (!strncmp(argv[index], "concurrency=", 12)) settings.concurrency = atoi(value);
+        else if (!strncmp(argv[index], "openings=", 9)) openings = value;
+        else if (!strncmp(argv[index], "alpha=", 6)) settings.alpha = atof(value);
+        else if (!strncmp(argv[index], "beta=", 5)) settings.beta = atof(value);
+
+        // Time control in seconds: base+increment
+        else if (!strncmp(argv[index], "tc=", 3)) {
+            char *increment = strchr(value, '+');
+            settings.base_time = atof(value) * 1000;
+            settings.increment = increment ? atof(increment + 1) * 1000 : 0;
+        }
+
+        // SPRT hypotheses: elo0,elo1
+        else if (!strncmp(argv[index], "sprt=", 5)) {
+            char *elo1 = strchr(value, ',');
+            settings.elo0 = atof(value);
+            settings.elo1 = elo1 ? atof(elo1 + 1) : settings.elo0 + 5.0;
+        }
+
+        else {
+            printf("     Unknown option %s\n", argv[index]);
+            return 1;
+        }
+    }
+
+    // Keep settings sane
+    if (settings.games < 1) settings.games = 1;
+    if (settings.concurrency < 1) settings.concurrency = 1;
+    if (settings.concurrency > match_max_slots) settings.concurrency = match_max_slots;
+    if (settings.base_time < 1) settings.base_time = 1;
+    if (settings.elo1 <= settings.elo0) settings.elo1 = settings.elo0 + 5.0;
+
+    if (!load_openings(openings)) return 1;
+
+    return run_match(&settings);
+}
+
+#endif
+
+/* ======================================================================== */
+/* ============================ Analysis server =========================== */
+/* ======================================================================== */
+
+/*
+    Long running analysis daemon: "chengine serve <socket>" listens on a Unix
+    domain socket & takes one command per line from any number of clients:
+
+        analyse fen <fen> [depth N] [movetime MS] [nodes N] [priority N] [deadline MS] [id TAG]
+        stats
+        shutdown
+
+    Jobs wait in a queue ordered by priority (higher first), then deadline,
+    then arrival, & a fixed pool of search threads takes them. All threads
+    share one hash table that stays warm between jobs (written without
+    locks like Lazy SMP) & the attack tables. A job that can't start before
+    its deadline is answered with "expired", a running job's search time is
+    capped by its deadline. Results ("result id ...") may come back out of
+    order, "stats" reports queue depth, latency percentiles & throughput.
+    Client sockets are non-blocking: replies queue up per client & go out
+    as the socket takes them, a client that stops reading is dropped.
+*/
+
+#ifndef WIN64
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <errno.h>
+
+// Server limits
+#define server_max_clients 64
+#define server_max_jobs 4096
+#define server_latency_samples 4096
+#define server_line_size 1024
+#define server_output_size 65536
+
+// Queued analysis job
+typedef struct {
+    // Client slot & its generation when the job was queued
+    int client;
+    int generation;
+
+    // Job tag echoed in the reply
+    char id[64];
+
+    // Position & limits
+    char fen[128];
+    int depth, move_time;
+    long node_limit;
+
+    // Priority, absolute deadline (0 for none) & arrival time in ms
+    int priority;
+    long long deadline;
+    long long arrival;
+    long sequence;
+} server_job;
+
+// Client connection
+typedef struct {
+    int fd;
+    int open;
+    int generation;
+
+    // Jobs queued or running, the connection is closed once they're answered
+    int pending;
+
+    // Partial input line
+    char buffer[server_line_size];
+    int length;
+
+    // Replies the socket didn't take yet (sockets are non-blocking)
+    char output[server_output_size];
+    int output_length;
+} server_client;
+
+// Server state shared by accept loop & search threads
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t job_ready;
+
+    server_client clients[server_max_clients];
+
+    server_job jobs[server_max_jobs];
+    int job_count;
+    long next_sequence;
+
+    // Search threads busy & server shutting down
+    int running;
+    int shutdown;
+
+    // Counters & latency samples (ring buffer with completion times)
+    long completed, expired, rejected;
+    int latencies[server_latency_samples];
+    long long completion_times[server_latency_samples];
+    long long start;
+
+    // Shared hash table
+    tt *hash_table;
+    int hash_entries;
+} server_state;
+
+// Server instance
+server_state server;
+
+// Send as much buffered output as the socket takes without blocking (server lock held)
+void server_flush(server_client *connection) {
+    while (connection->output_length) {
+        int count = send(connection->fd, connection->output, connection->output_length, MSG_NOSIGNAL);
+
+        // Socket is full, accept loop retries once it's writable
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+
+        // Client is gone, reading the socket closes the connection
+        if (count <= 0) {
+            connection->output_length = 0;
+            return;
+        }
+
+        connection->output_length -= count;
+        memmove(connection->output, connection->output + count, connection->output_length);
+    }
+}
+
+// Queue reply line for client unless it's gone, a client that stops reading is dropped (server lock held)
+void server_reply(int client, int generation, const char *line) {
+    server_client *connection = &server.clients[client];
+    int length = strlen(line);
+
+    if (!connection->open || connection->generation != generation) return;
+
+    if (connection->output_length + length > server_output_size) {
+        connection->output_length = 0;
+        shutdown(connection->fd, SHUT_RDWR);
+        return;
+    }
+
+    memcpy(connection->output + connection->output_length, line, length);
+    connection->output_length += length;
+    server_flush(connection);
+}
+
+// Job is answered, close connection of departed client after its last job (server lock held)
+void server_job_done(int client) {
+    server_client *connection = &server.clients[client];
+
+    if (--connection->pending == 0 && !connection->open && connection->fd >= 0) {
+        close(connection->fd);
+        connection->fd = -1;
+    }
+}
+
+// Pop next job: highest priority, then earliest deadline, then first come (server lock held)
+server_job pop_job() {
+    int best = 0;
+
+    for (int index = 1; index < server.job_count; index++) {
+        server_job *job = &server.jobs[index], *best_job = &server.jobs[best];
+
+        if (job->priority != best_job->priority) {
+            if (job->priority > best_job->priority) best = index;
+        }
+
+        else if (job->deadline != best_job->deadline) {
+            if (job->deadline && (!best_job->deadline || job->deadline < best_job->deadline)) best = index;
+        }
+
+        else if (job->sequence < best_job->sequence) best = index;
+    }
+
+    server_job job = server.jobs[best];
+    server.jobs[best] = server.jobs[--server.job_count];
+    return job;
+}
+
+// Record job latency (server lock held)
+void record_latency(long long now, int latency) {
+    int sample = (server.completed + server.expired) % server_latency_samples;
+    server.latencies[sample] = latency;
+    server.completion_times[sample] = now;
+}
+
+// Search thread: take jobs until shutdown
+void *server_worker(void *argument) {
+    (void)argument;
+
+    // Shared warm hash table
+    hash_table = server.hash_table;
+    hash_entries = server.hash_entries;
+
+    pthread_mutex_lock(&server.lock);
+
+    while (1) {
+        while (!server.job_count && !server.shutdown) pthread_cond_wait(&server.job_ready, &server.lock);
+        if (server.shutdown) break;
+
+        server_job job = pop_job();
+        long long now = get_time_ns() / 1000000;
+        char reply[512];
+
+        // Too late to start
+        if (job.deadline && now >= job.deadline) {
+            snprintf(reply, sizeof(reply), "expired id %s queue_ms %lld\n", job.id, now - job.arrival);
+            server_reply(job.client, job.generation, reply);
+            record_latency(now, now - job.arrival);
+            server.expired++;
+            server_job_done(job.client);
+            continue;
+        }
+
+        server.running++;
+        pthread_mutex_unlock(&server.lock);
+
+        // Init position & limits, deadline caps search time
+        parse_fen(job.fen);
+        int start = get_time_ms();
+        int move_time = job.move_time;
+
+        if (job.deadline && (!move_time || now + move_time > job.deadline)) move_time = job.deadline - now;
+
+        time_set = move_time > 0;
+        soft_time = stop_time = start + move_time;
+        node_limit = job.node_limit;
+
+        int depth = job.depth > 0 ? job.depth : (time_set || node_limit) ? max_ply - 1 : 6;
+        if (depth > max_ply - 1) depth = max_ply - 1;
+
+        // Search
+        int score;
+        int completed_depth = iterative_deepening(depth, &score, 0);
+
+        char move[6], score_string[24];
+        write_move(move, best_move);
+        write_score(score_string, score);
+
+        long long done = get_time_ns() / 1000000;
+        snprintf(reply, sizeof(reply), "result id %s bestmove %s %s depth %d nodes %ld time %d queue_ms %lld\n",
+                 job.id, move, score_string, completed_depth, nodes, get_time_ms() - start, now - job.arrival);
+
+        pthread_mutex_lock(&server.lock);
+        server_reply(job.client, job.generation, reply);
+        record_latency(done, done - job.arrival);
+        server.completed++;
+        server.running--;
+        server_job_done(job.client);
+    }
+
+    pthread_mutex_unlock(&server.lock);
+    return NULL;
+}
+
+// Compare ints for qsort
+int compare_ints(const void *first, const void *second) {
+    return *(const int *)first - *(const int *)second;
+}
+
+// Write server statistics line (server lock held)
+void server_stats(char *reply, int size) {
+    long long now = get_time_ns() / 1000000;
+    long answered = server.completed + server.expired;
+    int samples = answered < server_latency_samples ? answered : server_latency_samples;
+
+    // Latency percentiles over the most recent jobs
+    int sorted[server_latency_samples];
+    memcpy(sorted, server.latencies, samples * sizeof(int));
+    qsort(sorted, samples, sizeof(int), compare_ints);
+
+    // Throughput since start & over the last 10 seconds
+    int recent = 0;
+    for (int sample = 0; sample < samples; sample++) recent += now - server.completion_times[sample] <= 10000;
+
+    double uptime = (now - server.start) / 1000.0;
+
+    snprintf(reply, size,
+             "stats queue %d running %d completed %ld expired %ld rejected %ld latency_ms p50 %d p90 %d p99 %d "
+             "throughput %.1f/s recent %.1f/s uptime %.1f s\n",
+             server.job_count, server.running, server.completed, server.expired, server.rejected,
+             samples ? sorted[samples / 2] : 0, samples ? sorted[samples * 9 / 10] : 0,
+             samples ? sorted[samples * 99 / 100] : 0, uptime > 0 ? answered / uptime : 0.0,
+             recent / (uptime < 10 ? (uptime > 0 ? uptime : 1) : 10.0), uptime);
+}
+
+// Job option keywords, each followed by its value
+const char *job_keywords[] = { "depth", "movetime", "nodes", "priority", "deadline", "id" };
+enum { job_depth, job_move_time, job_nodes, job_priority, job_deadline, job_id, job_keyword_count };
+
+// Find job option keyword of token (-1 if token is no keyword)
+int job_keyword(const char *token) {
+    for (int keyword = 0; keyword < job_keyword_count; keyword++)
+        if (!strcmp(token, job_keywords[keyword])) return keyword;
+
+    return -1;
+}
+
+// Handle client command line (server lock held)
+void server_command(int client, char *line) {
+    server_client *connection = &server.clients[client];
+    char reply[512];
+
+    if (!strncmp(line, "analyse ", 8)) {
+        server_job job = { 0 };
+
+        // Split line into tokens, so keywords only match whole tokens
+        char *tokens[64], *save = NULL;
+        int count = 0;
+
+        for (char *token = strtok_r(line + 8, " \t", &save); token && count < 64; token = strtok_r(NULL, " \t", &save))
+            tokens[count++] = token;
+
+        if (!count || strcmp(tokens[0], "fen")) {
+            server_reply(client, connection->generation, "error missing fen\n");
+            return;
+        }
+
+        // FEN fields run up to the first option keyword
+        int token = 1, length = 0;
+
+        for (; token < count && job_keyword(tokens[token]) < 0; token++)
+            length += snprintf(job.fen + length, sizeof(job.fen) - length, "%s%s", length ? " " : "", tokens[token]);
+
+        // Validate position
+        if (length >= (int)sizeof(job.fen) || parse_fen(job.fen) != fen_ok) {
+            server_reply(client, connection->generation, "error bad fen\n");
+            return;
+        }
+
+        // Parse options: keyword & value pairs
+        long long deadline = 0;
+
+        for (; token < count; token += 2) {
+            int keyword = job_keyword(tokens[token]);
+
+            if (keyword < 0 || token + 1 == count) {
+                snprintf(reply, sizeof(reply), "error bad option %s\n", tokens[token]);
+                server_reply(client, connection->generation, reply);
+                return;
+            }
+
+            const char *value = tokens[token + 1];
+
+            switch (keyword) {
+                case job_depth: job.depth = atoi(value); break;
+                case job_move_time: job.move_time = atoi(value); break;
+                case job_nodes: job.node_limit = atol(value); break;
+                case job_priority: job.priority = atoi(value); break;
+                case job_deadline: deadline = atoll(value); break;
+                case job_id: snprintf(job.id, sizeof(job.id), "%s", value); break;
+            }
+        }
+
+        if (!job.id[0]) snprintf(job.id, sizeof(job.id), "%ld", server.next_sequence);
+
+        job.client = client;
+        job.generation = connection->generation;
+        job.arrival = get_time_ns() / 1000000;
+        job.deadline = deadline > 0 ? job.arrival + deadline : 0;
+        job.sequence = server.next_sequence++;
+
+        // Queue is full
+        if (server.job_count == server_max_jobs) {
+            snprintf(reply, sizeof(reply), "rejected id %s queue full\n", job.id);
+            server_reply(client, connection->generation, reply);
+            server.rejected++;
+            return;
+        }
+
+        server.jobs[server.job_count++] = job;
+        connection->pending++;
+        pthread_cond_signal(&server.job_ready);
+    }
+
+    else if (!strncmp(line, "stats", 5)) {
+        server_stats(reply, sizeof(reply));
+        server_reply(client, connection->generation, reply);
+    }
+
+    else if (!strncmp(line, "shutdown", 8)) {
+        // Abort running searches
+        __atomic_store_n(&search_abort, 1, __ATOMIC_RELAXED);
+        server.shutdown = 1;
+        pthread_cond_broadcast(&server.job_ready);
+    }
+
+    else if (*line) server_reply(client, connection->generation, "error unknown command\n");
+}
+
+// Run analysis server (returns 0 on clean shutdown)
+int serve(const char *path, int threads, int hash_mb) {
+    // Init listening socket
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        printf("     Socket path too long\n");
+        return 1;
+    }
+
+    strcpy(address.sun_path, path);
+    unlink(path);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (listener < 0 || bind(listener, (struct sockaddr *)&address, sizeof(address)) || listen(listener, 64)) {
+        printf("     Can't listen on %s\n", path);
+        if (listener >= 0) close(listener);
+        return 1;
+    }
+
+    // Init shared state & warm hash table
+    pthread_mutex_init(&server.lock, NULL);
+    pthread_cond_init(&server.job_ready, NULL);
+    server.start = get_time_ns() / 1000000;
+    for (int client = 0; client < server_max_clients; client++) server.clients[client].fd = -1;
+
+    init_hash_table(hash_mb);
+    server.hash_table = hash_table;
+    server.hash_entries = hash_entries;
+
+    // Generate bitbases before search threads start probing them
+    init_bitbases();
+
+    // Start search threads
+    if (threads < 1) threads = 1;
+    if (threads > max_threads) threads = max_threads;
+
+    pthread_t workers[max_threads];
+    int started = 0;
+
+    for (int thread = 0; thread < threads; thread++)
+        started += !pthread_create(&workers[started], NULL, server_worker, NULL);
+
+    printf("     Serving on %s with %d search threads, %d MB hash\n", path, started, hash_mb);
+    fflush(stdout);
+
+    // Accept & read clients
+    struct pollfd descriptors[server_max_clients + 1];
+    char line[server_line_size];
+
+    while (1) {
+        pthread_mutex_lock(&server.lock);
+        int shutdown = server.shutdown;
+
+        // Listening socket first, then open clients
+        descriptors[0] = (struct pollfd){ listener, POLLIN, 0 };
+
+        for (int client = 0; client < server_max_clients; client++) {
+            server_client *connection = &server.clients[client];
+            short events = POLLIN | (connection->output_length ? POLLOUT : 0);
+            descriptors[client + 1] = (struct pollfd){ connection->open ? connection->fd : -1, events, 0 };
+        }
+
+        pthread_mutex_unlock(&server.lock);
+
+        if (shutdown) break;
+        if (poll(descriptors, server_max_clients + 1, 100) <= 0) continue;
+
+        pthread_mutex_lock(&server.lock);
+
+        // New client takes a free slot (no open connection, no pending jobs)
+        if (descriptors[0].revents & POLLIN) {
+            int fd = accept(listener, NULL, NULL);
+            int slot = -1;
+
+            for (int client = 0; client < server_max_clients && slot < 0; client++)
+                if (server.clients[client].fd < 0) slot = client;
+
+            if (fd >= 0 && slot >= 0) {
+                server_client *connection = &server.clients[slot];
+                connection->fd = fd;
+                connection->open = 1;
+                connection->generation++;
+                connection->pending = 0;
+                connection->length = 0;
+                connection->output_length = 0;
+
+                // Replies are sent under the server lock, a slow client must never block it
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            }
+
+            else if (fd >= 0) {
+                send(fd, "error too many clients\n", 23, MSG_NOSIGNAL);
+                close(fd);
+            }
+        }
+
+        // Read client commands
+        for (int client = 0; client < server_max_clients; client++) {
+            server_client *connection = &server.clients[client];
+            if (!connection->open || !descriptors[client + 1].revents) continue;
+
+            // Socket takes more of the queued replies
+            if (descriptors[client + 1].revents & POLLOUT) server_flush(connection);
+            if (!(descriptors[client + 1].revents & ~POLLOUT)) continue;
+
+            // Drop overlong line rather than stall
+            if (connection->length == server_line_size - 1) connection->length = 0;
+
+            int count = read(connection->fd, connection->buffer + connection->length,
+                             server_line_size - 1 - connection->length);
+
+            // Nothing to read after all
+            if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+
+            // Client is gone, close connection once its jobs are answered
+            if (count <= 0) {
+                connection->open = 0;
+
+                if (!connection->pending) {
+                    close(connection->fd);
+                    connection->fd = -1;
+                }
+
+                continue;
+            }
+
+            connection->length += count;
+
+            // Handle complete lines
+            char *end;
+
+            while (connection->open && (end = memchr(connection->buffer, '\n', connection->length))) {
+                int length = end - connection->buffer;
+                memcpy(line, connection->buffer, length);
+                line[length] = '\0';
+                if (length && line[length - 1] == '\r') line[length - 1] = '\0';
+
+                connection->length -= length + 1;
+                memmove(connection->buffer, end + 1, connection->length);
+
+                server_command(client, line);
+            }
+        }
+
+        pthread_mutex_unlock(&server.lock);
+    }
+
+    // Stop search threads & close connections
+    for (int thread = 0; thread < started; thread++) pthread_join(workers[thread], NULL);
+
+    for (int client = 0; client < server_max_clients; client++)
+        if (server.clients[client].fd >= 0) close(server.clients[client].fd);
+
+    close(listener);
+    unlink(path);
+
+    printf("     Shut down after %ld jobs\n", server.completed);
+    return 0;
+}
+
+#endif
+
+/* ======================================================================== */
+/* ======================== Training data generator ======================= */
+/* ======================================================================== */
+
+/*
+    "chengine datagen <file> [games= threads= nodes= random= hash= seed=]"
+    plays self-play games on every thread: a few random opening moves, then
+    fixed node searches until mate, draw or a decisive score. Quiet positions
+    (side to move not in check, best move neither capture nor promotion, score
+    short of the adjudication score) are kept with the search score & stamped with the game result.
+
+    Records are packed positions with the score (white point of view) in the
+    reserved bytes, the result in bits 5-6 & the format bit 7 of the state
+    byte, 32 bytes each, so "unpack" prints them & packed file readers load
+    them as they are. Records without the format bit used an older result
+    encoding & are rejected.
+    Each thread fills its own buffer & appends it to the file at an offset
+    reserved with a single atomic add, there's no lock anywhere.
+*/
+
+#ifndef WIN64
+
+// Game results in training records (white point of view, plain packed positions have none)
+enum { training_no_result, training_black_wins, training_draw, training_white_wins };
+
+// State bit set in records of the current format (results above)
+#define training_format_bit 0x80
+
+// Generator defaults
+#define datagen_nodes 5000
+#define datagen_random_plies 8
+#define datagen_hash 8
+
+// Records buffered per thread (128 KB)
+#define datagen_buffer_records 4096
+
+// Games end in a draw at this many plies or once a side keeps a decisive score for a few moves
+#define datagen_max_plies 400
+#define datagen_win_score 2000
+#define datagen_win_plies 6
+
+// Store search score of training record (white point of view)
+static inline void set_training_score(packed_position *record, int score) {
+    unsigned short value = (short)score;
+    record->reserved[0] = value & 0xff;
+    record->reserved[1] = value >> 8;
+}
+
+// Read search score of training record (white point of view)
+static inline int get_training_score(const packed_position *record) {
+    return (short)(record->reserved[0] | (record->reserved[1] << 8));
+}
+
+// Read game result of training record
+static inline int get_training_result(const packed_position *record) {
+    return (record->state >> 5) & 3;
+}
+
+// Generator state shared by all threads
+typedef struct {
+    // Output file & next free offset
+    int fd;
+    long long offset;
+
+    // Settings
+    int games, nodes, random_plies, hash_mb;
+    U64 seed;
+
+    // Next game to play & totals
+    int next_game;
+    long positions;
+    int failed;
+} datagen_job;
+
+// Generator thread
+typedef struct {
+    datagen_job *job;
+    int index;
+
+    // Thread random state (xorshift)
+    U64 random;
+
+    // Buffered records
+    packed_position *records;
+    int count;
+
+    // Games & positions of this thread
+    int games;
+    long positions;
+} datagen_thread;
+
+// Next thread random number
+static inline U64 datagen_random(datagen_thread *thread) {
+    thread->random ^= thread->random << 13;
+    thread->random ^= thread->random >> 7;
+    thread->random ^= thread->random << 17;
+    return thread->random;
+}
+
+// Append buffered records to file at an atomically reserved offset
+void flush_records(datagen_thread *thread) {
+    size_t size = thread->count * sizeof(packed_position);
+    long long offset = __atomic_fetch_add(&thread->job->offset, (long long)size, __ATOMIC_RELAXED);
+    const char *data = (const char *)thread->records;
+
+    // Write may return early, continue where it stopped
+    while (size) {
+        ssize_t written = pwrite(thread->job->fd, data, size, offset);
+
+        if (written <= 0) {
+            thread->job->failed = 1;
+            break;
+        }
+
+        data += written;
+        offset += written;
+        size -= written;
+    }
+
+    thread->count = 0;
+}
+
+// Play random opening moves from start position (returns 0 if the game ended meanwhile)
+int play_random_opening(datagen_thread *thread) {
+    parse_fen(start_position);
+
+    for (int ply = 0; ply < thread->job->random_plies; ply++) {
+        moves move_list[1];
+        generate_moves(move_list);
+
+        // Collect legal moves
+        int legal[256], count = 0;
+
+        for (int index = 0; index < move_list->count; index++) {
+            copy_board();
+            if (make_move(move_list->moves[index], all_moves)) legal[count++] = move_list->moves[index];
+            take_back();
+        }
+
+        if (!count) return 0;
+
+        make_move(legal[datagen_random(thread) % count], all_moves);
+    }
+
+    return count_legal_moves() > 0;
+}
+
+// Play one self-play game, buffering its quiet positions
+void play_datagen_game(datagen_thread *thread) {
+    // Random opening (retry if it ends the game)
+    while (!play_random_opening(thread));
+
+    // Fresh hash table per game keeps games independent
+    clear_hash_table();
+
+    packed_position game[datagen_max_plies];
+    int count = 0, result = training_draw, decisive_plies = 0;
+
+    for (int ply = 0; ply < datagen_max_plies; ply++) {
+        int in_check = side_in_check();
+
+        // Checkmate or stalemate
+        if (!count_legal_moves()) {
+            if (in_check) result = side == white ? training_black_wins : training_white_wins;
+            break;
+        }
+
+        // Draw by fifty moves, repetition or material
+        if (fifty >= 100 || is_repetition() || insufficient_material()) break;
+
+        // Fixed node search
+        int score;
+        node_limit = thread->job->nodes;
+        iterative_deepening(max_ply - 1, &score, 0);
+        if (!best_move) break;
+
+        int white_score = side == white ? score : -score;
+
+        // Adjudicate decisive scores
+        if (abs(score) >= datagen_win_score) {
+            if (++decisive_plies >= datagen_win_plies) {
+                result = white_score > 0 ? training_white_wins : training_black_wins;
+                break;
+            }
+        }
+
+        else decisive_plies = 0;
+
+        // Keep quiet positions with undecided scores (no mate or known win)
+        if (!in_check && !get_move_capture(best_move) && !get_move_promoted(best_move) &&
+            abs(score) < datagen_win_score) {
+            pack_position(&game[count]);
+            set_training_score(&game[count++], white_score);
+        }
+
+        make_move(best_move, all_moves);
+    }
+
+    // Stamp game result & buffer records
+    for (int index = 0; index < count; index++) {
+        game[index].state |= result << 5 | training_format_bit;
+        thread->records[thread->count++] = game[index];
+        if (thread->count == datagen_buffer_records) flush_records(thread);
+    }
+
+    thread->games++;
+    thread->positions += count;
+}
+
+// Generator thread: play games until all are taken
+void *datagen_worker(void *argument) {
+    datagen_thread *thread = argument;
+    datagen_job *job = thread->job;
+    if (use_numa_pinning) pin_thread(thread->index);
+
+    // Thread own hash table & search limits
+    init_hash_table(job->hash_mb);
+    time_set = 0;
+
+    while (__atomic_fetch_add(&job->next_game, 1, __ATOMIC_RELAXED) < job->games)
+        play_datagen_game(thread);
+
+    flush_records(thread);
+    __atomic_fetch_add(&job->positions, thread->positions, __ATOMIC_RELAXED);
+
+    free(hash_table);
+    hash_table = NULL;
+    return NULL;
+}
+
+// Parse generator options given as key=value & generate training data
+int datagen(int argc, char *argv[]) {
+    // Default settings: 100 games on every core
+    datagen_job job = { -1, 0, 100, datagen_nodes, datagen_random_plies, datagen_hash, 0, 0, 0, 0 };
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    job.seed = get_time_ns();
+
+    for (int index = 3; index < argc; index++) {
+        char *value = strchr(argv[index], '=');
+
+        if (value == NULL) {
+            printf("     Unknown option %s\n", argv[index]);
+            return 1;
+        }
+
+        value++;
+
+        if (!strncmp(argv[index], "games=", 6)) job.games = atoi(value);
+        else if (!strncmp(argv[index], "threads=", 8)) threads = atoi(value);
+        else if (!strncmp(argv[index], "nodes=", 6)) job.nodes = atoi(value);
+        else if (!strncmp(argv[index], "random=", 7)) job.random_plies = atoi(value);
+        else if (!strncmp(argv[index], "hash=", 5)) job.hash_mb = atoi(value);
+        else if (!strncmp(argv[index], "seed=", 5)) job.seed = strtoull(value, NULL, 10);
+
+        else {
+            printf("     Unknown option %s\n", argv[index]);
+            return 1;
+        }
+    }
+
+    // Keep settings sane
+    if (job.games < 1) job.games = 1;
+    if (job.nodes < 1) job.nodes = 1;
+    if (job.random_plies < 0) job.random_plies = 0;
+    if (job.hash_mb < 1) job.hash_mb = 1;
+    if (threads < 1) threads = 1;
+    if (threads > max_threads) threads = max_threads;
+
+    // Open output file
+    job.fd = open(argv[2], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (job.fd < 0) {
+        printf("     Can't create %s\n", argv[2]);
+        return 1;
+    }
+
+    printf("\n     Generating %d games on %d threads, %d nodes per move, %d random plies\n\n",
+           job.games, threads, job.nodes, job.random_plies);
+
+    // Start threads
+    datagen_thread *workers = calloc(threads, sizeof(datagen_thread));
+    pthread_t *handles = malloc(threads * sizeof(pthread_t));
+    int started = 0;
+    long long start = get_time_ns();
+
+    for (int index = 0; index < threads; index++) {
+        datagen_thread *thread = &workers[started];
+        thread->job = &job;
+        thread->index = started;
+        thread->random = (job.seed + 1) * 0x9e3779b97f4a7c15ULL ^ (started + 1) * 0xbf58476d1ce4e5b9ULL;
+        thread->records = malloc(datagen_buffer_records * sizeof(packed_position));
+
+        if (thread->records != NULL && !pthread_create(&handles[started], NULL, datagen_worker, thread)) started++;
+        else free(thread->records);
+    }
+
+    for (int index = 0; index < started; index++) pthread_join(handles[index], NULL);
+
+    double seconds = (get_time_ns() - start) / 1e9;
+    close(job.fd);
+
+    // Print per thread & total throughput
+    for (int index = 0; index < started; index++) {
+        printf("     Thread %3d: %5d games %9ld positions\n", index, workers[index].games, workers[index].positions);
+        free(workers[index].records);
+    }
+
+    printf("\n     Games:         %d\n", job.games);
+    printf("     Positions:     %ld (%lld bytes)\n", job.positions, job.offset);
+    printf("     Time:          %.2f s\n", seconds);
+    printf("     Positions/s:   %.0f (%.0f per thread)\n\n", job.positions / seconds,
+           started ? job.positions / seconds / started : 0.0);
+
+    free(workers);
+    free(handles);
+
+    if (job.failed) printf("     Write to %s failed\n\n", argv[2]);
+    return job.failed || !started;
+}
+
+#endif
+
+/* ======================================================================== */
+/* ============================ Evaluation tuner ========================== */
+/* ======================================================================== */
+
+/*
+    "chengine tune <file> [epochs= threads= rate= output=]" fits material &
+    piece-square weights to game results (Texel method): minimize the mean
+    squared error between result (1, 0.5, 0) & sigmoid(K * eval) where
+    sigmoid(x) = 1 / (1 + 10^(-x / 400)). K is fit to the current weights
+    first, then weights follow Adam steps along the exact gradient (the
+    evaluation is linear in its weights).
+
+    Positions are loaded once into an array of packed positions (32 bytes
+    each) with the result in the training record bits: "*.bin" files as
+    written by "datagen", anything else as FEN lines annotated with a result
+    ("1-0", "0-1", "1/2-1/2" or [1.0], [0.5], [0.0]). Every thread sums loss
+    & gradient of its slice into its own accumulators, which are added up
+    after each epoch. Tuned weights are written as C tables ready to replace
+    the ones of the evaluation section.
+*/
+
+#ifndef WIN64
+
+// Tuned weights: material of pawn to queen, then piece-square tables of pawn, knight, bishop, rook & king
+#define tune_tables_offset 5
+#define tune_weights (tune_tables_offset + 5 * 64)
+
+// Tuner defaults
+#define tune_epochs 100
+#define tune_rate 1.0
+
+// Piece-square table of piece type (-1 for queen without one)
+static const int tune_table_index[6] = { 0, 1, 2, 3, -1, 4 };
+
+// Piece-square tables in tuner order
+int *tune_tables[5] = { pawn_score, knight_score, bishop_score, rook_score, king_score };
+
+// Piece-square table names in tuner order
+const char *tune_table_names[5] = { "Pawn", "Knight", "Bishop", "Rook", "King" };
+
+// Tuner thread with its slice of positions & own accumulators
+typedef struct {
+    const packed_position *positions;
+    long count;
+
+    // Weights & sigmoid scale
+    const double *weights;
+    double scale;
+
+    // Compute gradient too (loss only when fitting K)
+    int gradient_pass;
+
+    // Accumulators
+    double loss;
+    double gradient[tune_weights];
+} tune_thread;
+
+// Game result of training record as score (1 white wins, 0.5 draw, 0 black wins)
+static inline double training_target(const packed_position *record) {
+    return (get_training_result(record) - training_black_wins) / 2.0;
+}
+
+// Collect weight indexes of packed position with their signs (returns number of features)
+static inline int tune_features(const packed_position *record, short *indexes, signed char *signs) {
+    int count = 0, index = 0;
+
+    // Loop over occupied squares in LS1B order
+    for (U64 occupancy = record->occupancy; occupancy; occupancy &= occupancy - 1, index++) {
+        int square = get_ls1b_index(occupancy);
+        int piece = (record->pieces[index >> 1] >> ((index & 1) * 4)) & 15;
+
+        // Black squares are mirrored vertically
+        int type = piece % 6, sign = piece < 6 ? 1 : -1;
+        if (sign < 0) square ^= 56;
+
+        // Material (kings cancel out)
+        if (type != 5) {
+            indexes[count] = type;
+            signs[count++] = sign;
+        }
+
+        // Piece-square table
+        if (tune_table_index[type] >= 0) {
+            indexes[count] = tune_tables_offset + tune_table_index[type] * 64 + square;
+            signs[count++] = sign;
+        }
+    }
+
+    return count;
+}
+
+// Sum squared errors (& their gradient) over thread slice
+void *tune_worker(void *argument) {
+    tune_thread *thread = argument;
+    const double *weights = thread->weights;
+    short indexes[64];
+    signed char signs[64];
+
+    thread->loss = 0;
+    if (thread->gradient_pass) memset(thread->gradient, 0, sizeof(thread->gradient));
+
+    for (long position = 0; position < thread->count; position++) {
+        const packed_position *record = &thread->positions[position];
+        int count = tune_features(record, indexes, signs);
+
+        // Evaluate (white point of view)
+        double eval = 0;
+        for (int feature = 0; feature < count; feature++) eval += signs[feature] * weights[indexes[feature]];
+
+        double sigmoid = 1.0 / (1.0 + pow(10.0, -thread->scale * eval / 400.0));
+        double error = training_target(record) - sigmoid;
+        thread->loss += error * error;
+
+        // d(error^2) / d(weight) = -2 * error * sigmoid' * feature
+        if (thread->gradient_pass) {
+            double slope = -2.0 * error * sigmoid * (1.0 - sigmoid) * thread->scale * log(10.0) / 400.0;
+            for (int feature = 0; feature < count; feature++) thread->gradient[indexes[feature]] += slope * signs[feature];
+        }
+    }
+
+    return NULL;
+}
+
+// Mean squared error over all positions on given threads, sums gradient if given (returns loss)
+double tune_pass(const packed_position *positions, long count, const double *weights, double scale,
+                 double *gradient, tune_thread *threads, int thread_count) {
+    pthread_t handles[max_threads];
+    int started[max_threads];
+
+    // Split positions into slices
+    for (int index = 0; index < thread_count; index++) {
+        long first = count * index / thread_count, last = count * (index + 1) / thread_count;
+
+        threads[index].positions = positions + first;
+        threads[index].count = last - first;
+        threads[index].weights = weights;
+        threads[index].scale = scale;
+        threads[index].gradient_pass = gradient != NULL;
+
+        // Work on calling thread if a thread can't be started
+        started[index] = !pthread_create(&handles[index], NULL, tune_worker, &threads[index]);
+        if (!started[index]) tune_worker(&threads[index]);
+    }
+
+    // Add up thread accumulators
+    double loss = 0;
+    if (gradient) memset(gradient, 0, tune_weights * sizeof(double));
+
+    for (int index = 0; index < thread_count; index++) {
+        if (started[index]) pthread_join(handles[index], NULL);
+        loss += threads[index].loss;
+
+        if (gradient)
+            for (int weight = 0; weight < tune_weights; weight++) gradient[weight] += threads[index].gradient[weight];
+    }
+
+    if (gradient)
+        for (int weight = 0; weight < tune_weights; weight++) gradient[weight] /= count;
+
+    return loss / count;
+}
+
+// Parse result annotation of FEN line & cut it off (returns training result, training_no_result if none)
+int parse_training_result(char *line) {
+    // Annotation starts at bracket, quote or semicolon, otherwise it's the last field
+    char *annotation = strpbrk(line, "[\";");
+    if (annotation == NULL) annotation = strrchr(line, ' ');
+    if (annotation == NULL) return training_no_result;
+
+    int result = training_no_result;
+
+    if (strstr(annotation, "1/2") || strstr(annotation, "0.5")) result = training_draw;
+    else if (strstr(annotation, "1-0") || strstr(annotation, "1.0")) result = training_white_wins;
+    else if (strstr(annotation, "0-1") || strstr(annotation, "0.0")) result = training_black_wins;
+
+    if (result != training_no_result) *annotation = '\0';
+
+    // Drop EPD result opcode
+    char *opcode = strstr(line, " c9");
+    if (opcode) *opcode = '\0';
+
+    return result;
+}
+
+// Load positions with results from training records or annotated FEN lines (returns number of positions)
+long load_tune_positions(const char *path, packed_position **positions) {
+    long count = 0, capacity = 0;
+    *positions = NULL;
+
+    // Training records
+    if (strlen(path) > 4 && !strcmp(path + strlen(path) - 4, ".bin")) {
+        packed_file file;
+        if (!open_packed_file(path, &file)) return 0;
+
+        *positions = malloc(file.count * sizeof(packed_position));
+        long old_records = 0;
+
+        for (long index = 0; *positions && index < file.count; index++) {
+            const packed_position *record = &file.positions[index];
+            if (get_training_result(record) == training_no_result) continue;
+
+            // Results without format bit are in the old encoding
+            if (!(record->state & training_format_bit)) old_records++;
+            else (*positions)[count++] = *record;
+        }
+
+        close_packed_file(&file);
+
+        // Reject files written with the old encoding rather than misread their results
+        if (old_records) {
+            printf("     %s has %ld records in an old training format, regenerate it with datagen\n", path, old_records);
+            return 0;
+        }
+
+        return count;
+    }
+
+    // Annotated FEN lines
+    long size;
+    char *buffer = read_file(path, &size);
+    if (buffer == NULL) return 0;
+
+    for (char *line = buffer, *end = buffer + size; line < end;) {
+        // Copy line
+        char *next = memchr(line, '\n', end - line);
+        long length = (next ? next : end) - line;
+        char fen[fen_buffer_size + 64];
+        snprintf(fen, sizeof(fen), "%.*s", (int)(length < (long)sizeof(fen) - 1 ? length : (long)sizeof(fen) - 1), line);
+        fen[strcspn(fen, "\r")] = '\0';
+        line = next ? next + 1 : end;
+
+        // Keep valid positions with results
+        int result = parse_training_result(fen);
+
+        // Strip spaces left before the annotation
+        for (int last = strlen(fen) - 1; last >= 0 && fen[last] == ' '; last--) fen[last] = '\0';
+
+        if (result == training_no_result || parse_fen(fen) != fen_ok) continue;
+
+        // Grow array
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 65536;
+            packed_position *grown = realloc(*positions, capacity * sizeof(packed_position));
+
+            if (grown == NULL) break;
+            *positions = grown;
+        }
+
+        pack_position(&(*positions)[count]);
+        (*positions)[count++].state |= result << 5;
+    }
+
+    free(buffer);
+    return count;
+}
+
+// Write tuned weights as evaluation tables
+void write_tuned_tables(FILE *file, const double *weights) {
+    const char *names[5] = { "pawn", "knight", "bishop", "rook", "queen" };
+
+    // Material (kings keep their score)
+    fprintf(file, "// Material score [piece]\nint material_score[12] = {\n");
+
+    for (int color = 0; color < 2; color++)
+        for (int type = 0; type < 6; type++)
+            fprintf(file, "%7d,      // %s %s score\n",
+                    (color ? -1 : 1) * (type == 5 ? material_score[K] : (int)lround(weights[type])),
+                    color ? "black" : "white", type == 5 ? "king" : names[type]);
+
+    fprintf(file, "};\n");
+
+    // Piece-square tables
+    for (int table = 0; table < 5; table++) {
+        fprintf(file, "\n// %s positional score\nint %s_score[64] = {\n", tune_table_names[table],
+                table == 4 ? "king" : names[table]);
+
+        for (int square = 0; square < 64; square++)
+            fprintf(file, "%s%4d%s", square % 8 ? "" : "  ",
+                    (int)lround(weights[tune_tables_offset + table * 64 + square]),
+                    square == 63 ? "\n" : square % 8 == 7 ? ",\n" : ",");
+
+        fprintf(file, "};\n");
+    }
+}
+
+// Parse tuner options given as key=value, load positions & tune evaluation weights
+int tune(int argc, char *argv[]) {
+    int epochs = tune_epochs, threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    double rate = tune_rate;
+    const char *output = NULL;
+
+    for (int index = 3; index < argc; index++) {
+        char *value = strchr(argv[index], '=');
+
+        if (value == NULL) {
+            printf("     Unknown option %s\n", argv[index]);
+            return 1;
+        }
+
+        value++;
+
+        if (!strncmp(argv[index], "epochs=", 7)) epochs = atoi(value);
+        else if (!strncmp(argv[index], "threads=", 8)) threads = atoi(value);
+        else if (!strncmp(argv[index], "rate=", 5)) rate = atof(value);
+        else if (!strncmp(argv[index], "output=", 7)) output = value;
+
+        else {
+            printf("     Unknown option %s\n", argv[index]);
+            return 1;
+        }
+    }
+
+    if (epochs < 0) epochs = 0;
+    if (threads < 1) threads = 1;
+    if (threads > max_threads) threads = max_threads;
+
+    // Load positions once
+    packed_position *positions;
+    long long start = get_time_ns();
+    long count = load_tune_positions(argv[2], &positions);
+
+    if (!count) {
+        printf("     No positions with results in %s\n", argv[2]);
+        free(positions);
+        return 1;
+    }
+
+    printf("\n     Loaded %ld positions (%ld KB) in %.2f s, %d threads\n", count,
+           count * (long)sizeof(packed_position) / 1024, (get_time_ns() - start) / 1e9, threads);
+
+    // Init weights from evaluation tables
+    double weights[tune_weights], gradient[tune_weights], moment[tune_weights] = { 0 }, velocity[tune_weights] = { 0 };
+
+    for (int type = 0; type < 5; type++) weights[type] = material_score[type];
+
+    for (int table = 0; table < 5; table++)
+        for (int square = 0; square < 64; square++)
+            weights[tune_tables_offset + table * 64 + square] = tune_tables[table][square];
+
+    tune_thread *accumulators = malloc(threads * sizeof(tune_thread));
+
+    // Fit sigmoid scale K to current weights (ternary search)
+    double low = 0.1, high = 4.0;
+
+    while (high - low > 0.001) {
+        double first = low + (high - low) / 3, second = high - (high - low) / 3;
+
+        if (tune_pass(positions, count, weights, first, NULL, accumulators, threads) <
+            tune_pass(positions, count, weights, second, NULL, accumulators, threads))
+            high = second;
+        else
+            low = first;
+    }
+
+    double scale = (low + high) / 2;
+    double initial_loss = tune_pass(positions, count, weights, scale, NULL, accumulators, threads);
+    printf("     K = %.3f, initial loss %.6f\n\n", scale, initial_loss);
+
+    // Adam steps along the gradient
+    double loss = initial_loss, total_seconds = 0;
+
+    for (int epoch = 1; epoch <= epochs; epoch++) {
+        long long epoch_start = get_time_ns();
+        loss = tune_pass(positions, count, weights, scale, gradient, accumulators, threads);
+
+        for (int weight = 0; weight < tune_weights; weight++) {
+            moment[weight] = 0.9 * moment[weight] + 0.1 * gradient[weight];
+            velocity[weight] = 0.999 * velocity[weight] + 0.001 * gradient[weight] * gradient[weight];
+
+            double corrected_moment = moment[weight] / (1 - pow(0.9, epoch));
+            double corrected_velocity = velocity[weight] / (1 - pow(0.999, epoch));
+            weights[weight] -= rate * corrected_moment / (sqrt(corrected_velocity) + 1e-12);
+        }
+
+        double seconds = (get_time_ns() - epoch_start) / 1e9;
+        total_seconds += seconds;
+
+        if (epoch == 1 || epoch % 10 == 0 || epoch == epochs)
+            printf("     Epoch %4d: loss %.6f  %.0f ms  %.0f positions/s\n", epoch, loss, seconds * 1000,
+                   count / seconds);
+    }
+
+    loss = tune_pass(positions, count, weights, scale, NULL, accumulators, threads);
+
+    printf("\n     Loss:          %.6f -> %.6f\n", initial_loss, loss);
+    if (epochs) printf("     Positions/s:   %.0f per epoch\n\n", count * epochs / total_seconds);
+
+    // Write tuned tables
+    FILE *file = output ? fopen(output, "w") : stdout;
+
+    if (file == NULL) printf("     Can't write %s\n", output);
+
+    else {
+        write_tuned_tables(file, weights);
+        if (output) {
+            fclose(file);
+            printf("     Tuned tables written to %s\n\n", output);
+        }
+    }
+
+    free(accumulators);
+    free(positions);
+    return file == NULL;
+}
+
+#endif
+
+/* ======================================================================== */
+/* ========================== Attack tables file ========================== */
+/* ======================================================================== */
+
+/*
+    Attack tables serialized into a file that engine processes map read-only,
+    so all processes on a host share the same physical pages instead of
+    computing & holding private copies. Set CHENGINE_TABLES=<file> to use it,
+    write it with "chengine tables-write <file>". The file is rejected (and
+    tables are computed in process) when it's missing, truncated, from
+    another version, built for other magic numbers or fails the checksum.
+*/
+
+// Tables file magic ("CATT") & version
+#define tables_magic 0x54544143
+#define tables_version 1
+
+// Tables file header (payload follows at a cache line boundary)
+typedef struct {
+    unsigned int magic;
+    unsigned int version;
+    U64 signature;  // table layout & magic numbers
+    U64 checksum;   // payload checksum
+    U64 size;       // payload size
+    U64 reserved[4];
+} tables_header;
+
+// Attack tables come from a mapped file
+int tables_mapped = 0;
+
+// Time spent initializing shared tables in nanoseconds
+long long tables_init_time = 0;
+
+// Fold words into 64 bit checksum
+U64 checksum_words(U64 hash, const U64 *words, size_t count) {
+    for (size_t index = 0; index < count; index++)
+        hash = (hash ^ words[index]) * 0x100000001b3ULL;
+
+    return hash;
+}
+
+// Signature of table layout (changes with table sizes or magic numbers)
+U64 tables_signature() {
+    U64 signature = checksum_words(sizeof(attack_tables), rook_magic_numbers, 64);
+    return checksum_words(signature, bishop_magic_numbers, 64);
+}
+
+// Write attack tables into file (returns 0 on success)
+int write_tables_file(const char *path) {
+    // Write temporary file first, so processes never map a partial file
+    char temporary_path[1024];
+    snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", path);
+
+    FILE *file = fopen(temporary_path, "wb");
+
+    if (file == NULL) {
+        printf("     Can't create %s\n", temporary_path);
+        return 1;
+    }
+
+    // Tables in payload order
+    const U64 *tables[] = { pawn_attacks[0], knight_attacks, king_attacks, bishop_masks, rook_masks,
+                            bishop_attacks[0], rook_attacks[0] };
+    const size_t sizes[] = { 2 * 64, 64, 64, 64, 64, 64 * 512, 64 * 4096 };
+
+    tables_header header = { tables_magic, tables_version, tables_signature(), 0, sizeof(attack_tables), { 0 } };
+
+    for (int table = 0; table < 7; table++)
+        header.checksum = checksum_words(header.checksum, tables[table], sizes[table]);
+
+    // Write header & tables
+    int written = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    for (int table = 0; table < 7; table++)
+        written &= fwrite(tables[table], sizeof(U64), sizes[table], file) == sizes[table];
+
+    if (fclose(file) || !written || rename(temporary_path, path)) {
+        printf("     Can't write %s\n", path);
+        remove(temporary_path);
+        return 1;
+    }
+
+    printf("     Wrote %s (%zu bytes)\n", path, sizeof(header) + sizeof(attack_tables));
+    return 0;
+}
+
+// Map attack tables from file (returns 0 if file is missing or stale)
+int load_tables_file(const char *path) {
+    const void *data;
+    size_t size;
+
+    if (!map_file(path, &data, &size, 0)) return 0;
+
+    // Validate header & payload
+    const tables_header *header = data;
+    const attack_tables *tables = (const attack_tables *)(header + 1);
+
+    if (size != sizeof(tables_header) + sizeof(attack_tables) || header->magic != tables_magic ||
+        header->version != tables_version || header->signature != tables_signature() ||
+        header->size != sizeof(attack_tables) ||
+        header->checksum != checksum_words(0, (const U64 *)tables, sizeof(attack_tables) / sizeof(U64))) {
+        unmap_file(data, size);
+        return 0;
+    }
+
+    // Use mapped tables (mapping is read-only, tables are never written after init)
+    attack_tables *mapped = (attack_tables *)tables;
+    pawn_attacks = mapped->pawn_attacks;
+    knight_attacks = mapped->knight_attacks;
+    king_attacks = mapped->king_attacks;
+    bishop_masks = mapped->bishop_masks;
+    rook_masks = mapped->rook_masks;
+    bishop_attacks = mapped->bishop_attacks;
+    rook_attacks = mapped->rook_attacks;
+
+    return 1;
+}
+
+// Read resident memory counters of this process in kB (0 when unavailable)
+void read_memory_usage(long *rss, long *rss_anon, long *rss_file) {
+    *rss = *rss_anon = *rss_file = 0;
+
+    FILE *file = fopen("/proc/self/status", "r");
+    if (file == NULL) return;
+
+    char line[256];
+
+    while (fgets(line, sizeof(line), file)) {
+        sscanf(line, "VmRSS: %ld", rss);
+        sscanf(line, "RssAnon: %ld", rss_anon);
+        sscanf(line, "RssFile: %ld", rss_file);
+    }
+
+    fclose(file);
+}
+
+// Print table init mode, time & memory of this process (one line for bench-tables)
+int print_tables_stats() {
+    long rss, rss_anon, rss_file;
+    read_memory_usage(&rss, &rss_anon, &rss_file);
+
+    printf("%d %lld %ld %ld %ld\n", tables_mapped, tables_init_time, rss, rss_anon, rss_file);
+    return 0;
+}
+
+// Compare startup time & memory of processes computing tables & mapping them from file
+int bench_tables(const char *path) {
+    #ifdef WIN64
+        printf("     Tables file needs mmap\n");
+        return 1;
+    #else
+        // Make sure tables file is fresh
+        if (write_tables_file(path)) return 1;
+
+        // Find own executable
+        char executable[1024];
+        ssize_t length = readlink("/proc/self/exe", executable, sizeof(executable) - 1);
+
+        if (length <= 0) {
+            printf("     Can't find own executable\n");
+            return 1;
+        }
+
+        executable[length] = '\0';
+
+        const char *names[] = { "in process", "mapped file" };
+        const int runs = 20;
+
+        printf("\n     %d processes per mode\n\n", runs);
+        printf("     %-12s %12s %10s %10s %10s\n", "Mode", "Init", "RSS", "Anon", "File");
+
+        for (int mode = 0; mode < 2; mode++) {
+            long long init_time = 0;
+            long rss = 0, rss_anon = 0, rss_file = 0;
+            int mapped_runs = 0;
+
+            for (int run = 0; run < runs; run++) {
+                // Run process reporting its own stats through a pipe (no shell, any path works)
+                int pipe_fds[2];
+                if (pipe(pipe_fds)) continue;
+
+                pid_t pid = fork();
+
+                if (pid == 0) {
+                    dup2(pipe_fds[1], STDOUT_FILENO);
+                    close(pipe_fds[0]);
+                    close(pipe_fds[1]);
+
+                    // Tables file only in mapped mode
+                    if (mode) setenv("CHENGINE_TABLES", path, 1);
+                    else unsetenv("CHENGINE_TABLES");
+
+                    execl(executable, executable, "tables-stats", (char *)NULL);
+                    _exit(127);
+                }
+
+                close(pipe_fds[1]);
+
+                if (pid < 0) {
+                    close(pipe_fds[0]);
+                    continue;
+                }
+
+                FILE *process = fdopen(pipe_fds[0], "r");
+
+                if (process == NULL) {
+                    close(pipe_fds[0]);
+                    waitpid(pid, NULL, 0);
+                    continue;
+                }
+
+                int mapped;
+                long long time;
+                long process_rss, process_anon, process_file;
+
+                if (fscanf(process, "%d %lld %ld %ld %ld", &mapped, &time, &process_rss, &process_anon,
+                           &process_file) == 5) {
+                    mapped_runs += mapped;
+                    init_time += time;
+                    rss += process_rss;
+                    rss_anon += process_anon;
+                    rss_file += process_file;
+                }
+
+                fclose(process);
+                waitpid(pid, NULL, 0);
+            }
+
+            printf("     %-12s %9.1f us %7ld kB %7ld kB %7ld kB\n", names[mode], init_time / 1000.0 / runs,
+                   rss / runs, rss_anon / runs, rss_file / runs);
+
+            if (mode && mapped_runs != runs) printf("     Only %d of %d processes mapped the file\n", mapped_runs, runs);
+        }
+
+        printf("\n     Anonymous memory is private per process, mapped file pages are shared by all processes\n\n");
+        return 0;
+    #endif
+}
+
+/* ======================================================================== */
+/* ========================= Primitives benchmark ========================= */
+/* ======================================================================== */
+
+/*
+    Times bitboard primitives over fixed pseudo random inputs. Each primitive
+    runs several repeats and the fastest one is kept, so numbers stay stable
+    enough to compare compiler flags & bit scan backends. Time stamp counter
+    ticks are always reported, Linux perf_event hardware counters when the
+    kernel allows them (see /proc/sys/kernel/perf_event_paranoid).
+*/
+
+// Number of inputs, passes over inputs per repeat & repeats per primitive
+#define primitive_inputs 4096
+#define primitive_rounds 256
+#define primitive_repeats 7
+
+// Hardware counters: cycles, instructions, L1D read misses, LLC misses
+enum { perf_cycles, perf_instructions, perf_l1d_misses, perf_llc_misses, perf_counter_count };
+
+// Open hardware counters (-1 when unavailable)
+int perf_fds[perf_counter_count];
+
+// Counter values of the last measurement
+U64 perf_values[perf_counter_count];
+
+// Read time stamp counter
+static inline U64 read_cycles() {
+    #if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+    #elif defined(__aarch64__)
+        U64 value;
+        __asm__ volatile("mrs %0, cntvct_el0" : "=r"(value));
+        return value;
+    #else
+        return get_time_ns();
+    #endif
+}
+
+// Open hardware counters of this thread, user space only
+void open_perf_counters() {
+    for (int counter = 0; counter < perf_counter_count; counter++) {
+        perf_fds[counter] = -1;
+
+        #ifdef __linux__
+            // Init counter config
+            struct perf_event_attr attributes;
+            memset(&attributes, 0, sizeof(attributes));
+            attributes.size = sizeof(attributes);
+            attributes.disabled = 1;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            attributes.type = (counter == perf_l1d_misses) ? PERF_TYPE_HW_CACHE : PERF_TYPE_HARDWARE;
+
+            switch (counter) {
+                case perf_cycles: attributes.config = PERF_COUNT_HW_CPU_CYCLES; break;
+                case perf_instructions: attributes.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+                case perf_l1d_misses:
+                    attributes.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+                    break;
+                case perf_llc_misses: attributes.config = PERF_COUNT_HW_CACHE_MISSES; break;
+            }
+
+            perf_fds[counter] = syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0);
+        #endif
+    }
+}
+
+// Close hardware counters
+void close_perf_counters() {
+    for (int counter = 0; counter < perf_counter_count; counter++) {
+        #ifdef __linux__
+            if (perf_fds[counter] >= 0) close(perf_fds[counter]);
+        #endif
+
+        perf_fds[counter] = -1;
+    }
+}
+
+// Reset & start hardware counters
+static inline void start_perf_counters() {
+    #ifdef __linux__
+        for (int counter = 0; counter < perf_counter_count; counter++) {
+            if (perf_fds[counter] < 0) continue;
+            ioctl(perf_fds[counter], PERF_EVENT_IOC_RESET, 0);
+            ioctl(perf_fds[counter], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    #endif
+}
+
+// Stop hardware counters & read their values
+static inline void stop_perf_counters() {
+    for (int counter = 0; counter < perf_counter_count; counter++) {
+        perf_values[counter] = 0;
+
+        #ifdef __linux__
+            if (perf_fds[counter] < 0) continue;
+            ioctl(perf_fds[counter], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(perf_fds[counter], &perf_values[counter], sizeof(U64)) != sizeof(U64)) perf_values[counter] = 0;
+        #endif
+    }
+}
+
+// Keep compiler from merging passes over the same inputs
+#ifdef __GNUC__
+    #define compiler_barrier() __asm__ volatile("" ::: "memory")
+#else
+    #define compiler_barrier()
+#endif
+
+// Fastest repeat of a primitive
+typedef struct {
+    U64 ticks;
+    long long time;
+    U64 counters[perf_counter_count];
+} primitive_result;
+
+// Benchmark inputs
+U64 primitive_occupancies[primitive_inputs];
+int primitive_squares[primitive_inputs];
+int primitive_indices[primitive_inputs];
+
+// Sink for primitive results
+volatile U64 primitive_sink;
+
+// Time expression over all inputs, print fastest repeat per call
+#define bench_primitive(name, expression)                                                      \
+    {                                                                                          \
+        primitive_result best = { ~0ULL, 0, {0} };                                             \
+                                                                                               \
+        for (int repeat = 0; repeat < primitive_repeats; repeat++) {                           \
+            U64 sink = 0;                                                                      \
+            start_perf_counters();                                                             \
+            long long start_time = get_time_ns();                                              \
+            U64 start_ticks = read_cycles();                                                   \
+                                                                                               \
+            for (int round = 0; round < primitive_rounds; round++) {                           \
+                for (int index = 0; index < primitive_inputs; index++) sink += (expression);   \
+                compiler_barrier();                                                            \
+            }                                                                                  \
+                                                                                               \
+            U64 ticks = read_cycles() - start_ticks;                                           \
+            long long time = get_time_ns() - start_time;                                       \
+            stop_perf_counters();                                                              \
+            primitive_sink += sink;                                                            \
+                                                                                               \
+            if (ticks < best.ticks) {                                                          \
+                best.ticks = ticks;                                                            \
+                best.time = time;                                                              \
+                memcpy(best.counters, perf_values, sizeof(perf_values));                       \
+            }                                                                                  \
+        }                                                                                      \
+                                                                                               \
+        print_primitive(name, &best);                                                          \
+    }
+
+// Print per call numbers of a primitive
+void print_primitive(const char *name, const primitive_result *result) {
+    double calls = (double)primitive_inputs * primitive_rounds;
+
+    printf("     %-26s %8.2f %8.2f", name, result->ticks / calls, result->time / calls);
+
+    // Hardware counters per call, misses per thousand calls
+    if (perf_fds[perf_cycles] >= 0) printf(" %8.2f", result->counters[perf_cycles] / calls);
+    else printf(" %8s", "n/a");
+
+    if (perf_fds[perf_instructions] >= 0) printf(" %8.2f", result->counters[perf_instructions] / calls);
+    else printf(" %8s", "n/a");
+
+    if (perf_fds[perf_cycles] >= 0 && perf_fds[perf_instructions] >= 0 && result->counters[perf_cycles])
+        printf(" %6.2f", (double)result->counters[perf_instructions] / result->counters[perf_cycles]);
+    else printf(" %6s", "n/a");
+
+    if (perf_fds[perf_l1d_misses] >= 0) printf(" %9.3f", result->counters[perf_l1d_misses] * 1000.0 / calls);
+    else printf(" %9s", "n/a");
+
+    if (perf_fds[perf_llc_misses] >= 0) printf(" %9.3f", result->counters[perf_llc_misses] * 1000.0 / calls);
+    else printf(" %9s", "n/a");
+
+    printf("\n");
+}
+
+// Time bitboard primitives & attack lookups
+int bench_primitives() {
+    // Fixed seed xorshift keeps inputs identical between runs & builds
+    U64 seed = 0x9e3779b97f4a7c15ULL;
+
+    for (int index = 0; index < primitive_inputs; index++) {
+        // Sparse occupancies like middlegame boards (about a quarter of squares set)
+        U64 random[2];
+
+        for (int word = 0; word < 2; word++) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            random[word] = seed;
+        }
+
+        primitive_occupancies[index] = (random[0] & random[1]) | (1ULL << (random[0] >> 58));
+        primitive_squares[index] = random[1] >> 58;
+        primitive_indices[index] = (random[0] >> 20) & ((1 << rook_relevant_bits[random[1] >> 58]) - 1);
+    }
+
+    // Board for attacked square queries
+    parse_fen(tricky_position);
+
+    // Open hardware counters
+    open_perf_counters();
+
+    printf("\n     Bit scan backend: %s  Inputs: %d  Calls per repeat: %d  Repeats: %d (fastest kept)\n",
+           bits_backend, primitive_inputs, primitive_inputs * primitive_rounds, primitive_repeats);
+
+    if (perf_fds[perf_cycles] < 0)
+        printf("     perf_event counters unavailable, only time stamp counter ticks are reported\n");
+
+    printf("\n     %-26s %8s %8s %8s %8s %6s %9s %9s\n", "Primitive", "ticks", "ns", "cycles",
+           "instr", "IPC", "L1D/1k", "LLC/1k");
+
+    // Bit scans (active backend & portable loops)
+    bench_primitive("count_bits", count_bits(primitive_occupancies[index]));
+    bench_primitive("count_bits_portable", count_bits_portable(primitive_occupancies[index]));
+    bench_primitive("get_ls1b_index", get_ls1b_index(primitive_occupancies[index]));
+    bench_primitive("get_ls1b_index_portable", get_ls1b_index_portable(primitive_occupancies[index]));
+
+    // Attack lookups
+    bench_primitive("get_bishop_attacks", get_bishop_attacks(primitive_squares[index], primitive_occupancies[index]));
+    bench_primitive("get_rook_attacks", get_rook_attacks(primitive_squares[index], primitive_occupancies[index]));
+    bench_primitive("get_queen_attacks", get_queen_attacks(primitive_squares[index], primitive_occupancies[index]));
+    bench_primitive("is_square_attacked", is_square_attacked(primitive_squares[index], index & 1));
+
+    // Occupancy enumeration used by magic table init
+    bench_primitive("set_occupancy", set_occupancy(primitive_indices[index], rook_relevant_bits[primitive_squares[index]],
+                                                   rook_masks[primitive_squares[index]]));
+
+    printf("\n");
+    close_perf_counters();
+
+    return 0;
+}
+
+/* ========================================================================== */
+/* ============================== Init all ================================== */
+/* ========================================================================== */
+
+// Init tables shared read-only by all threads
+void init_shared_tables() {
+    long long start = get_time_ns();
+
+    // Map attack tables from file if configured & valid
+    const char *path = getenv("CHENGINE_TABLES");
+
+    #ifndef WIN64
+        if (path != NULL && *path) {
+            tables_mapped = load_tables_file(path);
+            if (!tables_mapped) fprintf(stderr, "Tables file %s is missing or stale, computing tables\n", path);
+        }
+    #endif
+
+    if (!tables_mapped) {
+        // Init leaper pieces attacks
+        init_leapers_attacks();
+
+        // Init slider pieces attacks
+        init_sliders_attacks(bishop);
+        init_sliders_attacks(rook);
+    }
+
+    // Init hashing keys
+    init_random_keys();
+
+    tables_init_time = get_time_ns() - start;
+}
+
+// Init all variables
+void init_all() {
+    // Init attack tables & hashing keys
+    init_shared_tables();
+
+    // Detect NUMA nodes for thread pinning & hash table placement
+    detect_numa_topology();
+
+    // Init hash table with default size
+    init_hash_table(hash_size_default);
+}
+
+/* ======================================================================== */
+/* =============================== Library ================================ */
+/* ======================================================================== */
+
+/*
+    libchengine API (see chengine.h), built with -DCHENGINE_LIBRARY instead of
+    main(). Board & search state are thread local, so every API call loads
+    its context into the calling thread's state, which lets contexts on
+    different threads search at the same time. Shared tables are read-only
+    after the one time init.
+*/
+
+#ifdef CHENGINE_LIBRARY
+
+// Exported symbols (library is built with hidden visibility)
+#define chengine_api __attribute__((visibility("default")))
+
+// Engine context: position with history & transposition table
+struct chengine_context {
+    board_state board;
+    tt *hash_table;
+    int hash_entries;
+};
+
+// Shared tables init guard
+pthread_once_t library_once = PTHREAD_ONCE_INIT;
+
+// Init shared tables, bitbases too since lazy generation would race between threads
+void init_library() {
+    init_shared_tables();
+    detect_numa_topology();
+    init_bitbases();
+}
+
+// Load context into calling thread's state
+void load_context(chengine_context *context) {
+    load_board(&context->board);
+    hash_table = context->hash_table;
+    hash_entries = context->hash_entries;
+}
+
+// Store calling thread's position into context
+void save_context(chengine_context *context) {
+    save_board(&context->board);
+}
+
+chengine_api chengine_context *chengine_create(int hash_mb) {
+    pthread_once(&library_once, init_library);
+
+    chengine_context *context = calloc(1, sizeof(chengine_context));
+    if (context == NULL) return NULL;
+
+    // Allocate table through calling thread's state without freeing another context's table
+    hash_table = NULL;
+    init_hash_table(hash_mb > 0 ? hash_mb : 1);
+    context->hash_table = hash_table;
+    context->hash_entries = hash_entries;
+    hash_table = NULL;
+
+    if (context->hash_table == NULL) {
+        free(context);
+        return NULL;
+    }
+
+    // Init start position
+    parse_fen(start_position);
+    save_context(context);
+
+    return context;
+}
+
+chengine_api void chengine_destroy(chengine_context *context) {
+    if (context == NULL) return;
+
+    // Forget table in calling thread's state
+    if (hash_table == context->hash_table) hash_table = NULL;
+
+    free(context->hash_table);
+    free(context);
+}
+
+chengine_api int chengine_set_fen(chengine_context *context, const char *fen) {
+    int error = parse_fen(fen);
+    if (error == fen_ok) save_context(context);
+
+    return error;
+}
+
+chengine_api int chengine_generate_moves(chengine_context *context, char (*moves_out)[6], int max_moves) {
+    load_context(context);
+
+    moves move_list[1];
+    generate_moves(move_list);
+
+    int legal_moves = 0;
+
+    for (int count = 0; count < move_list->count; count++) {
+        copy_board();
+
+        if (make_move(move_list->moves[count], all_moves)) {
+            if (legal_moves < max_moves) write_move(moves_out[legal_moves], move_list->moves[count]);
+            legal_moves++;
+        }
+
+        take_back();
+    }
+
+    return legal_moves;
+}
+
+chengine_api int chengine_evaluate(chengine_context *context) {
+    load_context(context);
+    return evaluate();
+}
+
+chengine_api int chengine_search(chengine_context *context, const chengine_limits *limits, chengine_result *result) {
+    load_context(context);
+
+    // Init limits
+    int start = get_time_ms();
+    time_set = limits->movetime > 0;
+    soft_time = stop_time = start + limits->movetime;
+    node_limit = limits->nodes > 0 ? limits->nodes : 0;
+
+    int depth = limits->depth > 0 ? limits->depth : (time_set || node_limit) ? max_ply - 1 : 6;
+    if (depth > max_ply - 1) depth = max_ply - 1;
+
+    // Search
+    int score;
+    result->depth = iterative_deepening(depth, &score, 0);
+    result->nodes = nodes;
+    result->time = get_time_ms() - start;
+
+    // Best move & score, mates in moves like UCI "score mate"
+    if (best_move) write_move(result->best_move, best_move);
+    else result->best_move[0] = '\0';
+
+    result->score = score;
+    result->mate = 0;
+
+    if (score > -mate_value && score < -mate_score) result->mate = -(score + mate_value) / 2 - 1;
+    else if (score > mate_score && score < mate_value) result->mate = (mate_value - score) / 2 + 1;
+
+    // Leave no limits behind for the next call on this thread
+    time_set = 0;
+    node_limit = 0;
+
+    return 0;
+}
+
+// Batch shared by worker threads
+typedef struct {
+    const char **fens;
+    int count;
+    const chengine_limits *limits;
+    chengine_result *results;
+    int hash_mb;
+
+    // Next position to analyse & positions analysed
+    int next;
+    int analysed;
+} batch_job;
+
+// Batch worker: take positions until none are left
+void *batch_worker(void *argument) {
+    batch_job *job = argument;
+    chengine_context *context = chengine_create(job->hash_mb);
+    if (context == NULL) return NULL;
+
+    int index;
+
+    while ((index = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->count) {
+        // Search every position from a fresh table
+        memset(context->hash_table, 0, context->hash_entries * sizeof(tt));
+
+        if (chengine_set_fen(context, job->fens[index]) != fen_ok) {
+            memset(&job->results[index], 0, sizeof(chengine_result));
+            continue;
+        }
+
+        chengine_search(context, job->limits, &job->results[index]);
+        __atomic_fetch_add(&job->analysed, 1, __ATOMIC_RELAXED);
+    }
+
+    chengine_destroy(context);
+    return NULL;
+}
+
+chengine_api int chengine_analyse_batch(const char **fens, int count, const chengine_limits *limits,
+                                        chengine_result *results, int threads, int hash_mb) {
+    pthread_once(&library_once, init_library);
+
+    batch_job job = { fens, count, limits, results, hash_mb, 0, 0 };
+
+    // One thread per core by default, never more threads than positions
+    if (threads < 1) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads > count) threads = count;
+    if (threads < 1) return 0;
+
+    pthread_t *workers = malloc(threads * sizeof(pthread_t));
+    int started = 0;
+
+    for (int thread = 0; thread < threads; thread++)
+        if (!pthread_create(&workers[started], NULL, batch_worker, &job)) started++;
+
+    // Analyse on calling thread if no thread could be started
+    if (!started) batch_worker(&job);
+
+    for (int thread = 0; thread < started; thread++)
+        pthread_join(workers[thread], NULL);
+
+    free(workers);
+    return job.analysed;
+}
+
+#endif
+
+
+/* ====================================================================== */
+/* ============================== Main ================================== */
+/* ====================================================================== */
+
+#ifndef CHENGINE_LIBRARY
+
+int main(int argc, char *argv[]) {
+    // Init all
+    init_all();
+
+    // Run FEN parser benchmark
+    if (argc > 1 && !strcmp(argv[1], "bench-fen"))
+        return bench_fen(argc > 2 ? argv[2] : NULL);
+
+    // Convert FEN file to packed positions file
+    if (argc > 3 && !strcmp(argv[1], "pack"))
+        return pack_fen_file(argv[2], argv[3]);
+
+    // Print packed positions file as FEN
+    if (argc > 2 && !strcmp(argv[1], "unpack"))
+        return unpack_to_fen(argv[2]);
+
+    // Run packed positions read benchmark
+    if (argc > 1 && !strcmp(argv[1], "bench-pack"))
+        return bench_pack(argc > 2 ? argv[2] : NULL);
+
+    // Build opening book from games file
+    if (argc > 3 && !strcmp(argv[1], "make-book"))
+        return make_book(argv[2], argv[3], argc > 4 ? atoi(argv[4]) : 24);
+
+    // Print book moves
+    if (argc > 2 && !strcmp(argv[1], "book"))
+        return print_book(argv[2], argc > 3 ? argv[3] : start_position);
+
+    // Check position keys against the Polyglot test keys
+    if (argc > 1 && !strcmp(argv[1], "book-keys"))
+        return book_keys();
+
+    // Run perft test
+    if (argc > 2 && !strcmp(argv[1], "perft")) {
+        if (parse_fen(argc > 3 ? argv[3] : start_position) != fen_ok) {
+            printf(" Bad FEN\n");
+            return 1;
+        }
+
+        perft_test(atoi(argv[2]));
+        return 0;
+    }
+
+    // Run bitboard primitives benchmark
+    if (argc > 1 && !strcmp(argv[1], "bench-primitives"))
+        return bench_primitives();
+
+    // Run selective search benchmark
+    if (argc > 1 && !strcmp(argv[1], "bench-search"))
+        return bench_search(argc > 2 ? atoi(argv[2]) : 6);
+
+    // Play match between two engines
+    #ifndef WIN64
+        if (argc > 3 && !strcmp(argv[1], "match"))
+            return match(argc, argv);
+    #endif
+
+    // Write attack tables file for CHENGINE_TABLES
+    if (argc > 2 && !strcmp(argv[1], "tables-write"))
+        return write_tables_file(argv[2]);
+
+    // Print table init stats of this process
+    if (argc > 1 && !strcmp(argv[1], "tables-stats"))
+        return print_tables_stats();
+
+    // Compare computed & mapped attack tables
+    if (argc > 2 && !strcmp(argv[1], "bench-tables"))
+        return bench_tables(argv[2]);
+
+    // Run deterministic search benchmark (node count signature & NPS)
+    if (argc > 1 && !strcmp(argv[1], "bench"))
+        return bench(argc > 2 ? atoi(argv[2]) : bench_depth);
+
+    // Run Lazy SMP & NUMA pinning benchmark
+    if (argc > 1 && !strcmp(argv[1], "bench-smp"))
+        return bench_smp(argc > 2 ? atoi(argv[2]) : bench_depth, argc > 3 ? atoi(argv[3]) : 0);
+
+    // Run analysis server on Unix domain socket
+    #ifndef WIN64
+        if (argc > 2 && !strcmp(argv[1], "serve"))
+            return serve(argv[2], argc > 3 ? atoi(argv[3]) : (int)sysconf(_SC_NPROCESSORS_ONLN),
+                         argc > 4 ? atoi(argv[4]) : 256);
+    #endif
+
+    // Tune evaluation weights to game results
+    #ifndef WIN64
+        if (argc > 2 && !strcmp(argv[1], "tune"))
+            return tune(argc, argv);
+    #endif
+
+    // Generate self-play training data
+    #ifndef WIN64
+        if (argc > 2 && !strcmp(argv[1], "datagen"))
+            return datagen(argc, argv);
+    #endif
+
+    // Prove or disprove checking mate in N moves
+    if (argc > 2 && !strcmp(argv[1], "mate"))
+        return mate(argc, argv);
+
+    // Run PVS & aspiration windows benchmark
+    if (argc > 1 && !strcmp(argv[1], "bench-pvs"))
+        return bench_pvs(argc > 2 ? atoi(argv[2]) : 8);
+
+    // Run MultiPV cost benchmark
+    if (argc > 1 && !strcmp(argv[1], "bench-multipv"))
+        return bench_multi_pv(argc > 2 ? atoi(argv[2]) : 8, argc > 3 ? atoi(argv[3]) : 8);
+
+    // Run endgame bitbase benchmark
+    if (argc > 1 && !strcmp(argv[1], "bench-bitbase"))
+        return bench_bitbase(argc > 2 ? atoi(argv[2]) : 10);
+
+    // Generate tablebases
+    if (argc > 3 && !strcmp(argv[1], "tb-generate"))
+        return tb_generate_tables(argv[2], argv + 3, argc - 3);
+
+    // Run tablebase benchmark
+    if (argc > 2 && !strcmp(argv[1], "bench-tb"))
+        return bench_tb(argv[2], argc > 3 ? atoi(argv[3]) : 8);
+
+    // Connect to the GUI
+    uci_loop();
+
+    // Free hash table memory & unmap files on exit
+    free(hash_table);
+    book_close();
+    tb_close();
+
+    return 0;
+}
+
+#endif
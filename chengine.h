@@ -0,0 +1,66 @@
+#ifndef CHENGINE_H
+#define CHENGINE_H
+
+/*
+    libchengine: in-process engine API.
+
+    Build with "make lib" (libchengine.a & libchengine.so) and link with
+    -lchengine -lm -pthread. Attack tables & hashing keys are initialized
+    once on first use & shared read-only by all contexts. A context holds a
+    position & its own transposition table; different contexts may be used
+    concurrently from different threads, a single context from one thread
+    at a time.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Opaque engine context
+typedef struct chengine_context chengine_context;
+
+// Search limits (0 means no limit, depth defaults to 6 without any limit)
+typedef struct {
+    int depth;
+    int movetime;
+    long nodes;
+} chengine_limits;
+
+// Search result
+typedef struct {
+    char best_move[6];  // UCI move ("" without legal moves)
+    int score;          // centipawns from side to move point of view
+    int mate;           // moves to mate (negative when getting mated), 0 if no mate found
+    int depth;          // depth of the last complete iteration
+    long nodes;
+    int time;           // milliseconds
+} chengine_result;
+
+// Create context with transposition table of given size in MB, start position set (NULL on failure)
+chengine_context *chengine_create(int hash_mb);
+
+// Free context
+void chengine_destroy(chengine_context *context);
+
+// Set position from FEN (returns 0 on success, FEN error code otherwise)
+int chengine_set_fen(chengine_context *context, const char *fen);
+
+// Write legal moves as UCI strings (returns number of legal moves, writes at most max_moves)
+int chengine_generate_moves(chengine_context *context, char (*moves)[6], int max_moves);
+
+// Static evaluation from side to move point of view in centipawns
+int chengine_evaluate(chengine_context *context);
+
+// Search position within limits (returns 0 on success)
+int chengine_search(chengine_context *context, const chengine_limits *limits, chengine_result *result);
+
+// Search array of FENs on given number of threads, each thread with its own hash_mb table
+// (returns number of positions analysed, results of invalid FENs have an empty best move)
+int chengine_analyse_batch(const char **fens, int count, const chengine_limits *limits, chengine_result *results,
+                           int threads, int hash_mb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif